@@ -0,0 +1,820 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   The basic block compiler of GORBIT-ROM-BB and GORBIT-ROM-TIER.
+
+   Most of what a GORBITSA program does is shuffle values between the accumulator and memory:
+   "G0 I2 O1 g1" is four instructions to load through a pointer at an offset from cell 0, and "S0 B80"
+   is two to jump. Every one of them is a dispatch. This compiles the program, a basic block at a time,
+   into fewer and bigger operations, which are threaded through like GORBIT-ROM-DT's instructions.
+
+   A block starts wherever the program jumps to, and ends at the first jump that can't be decided when
+   compiling it. Any instruction can be jumped to (b takes its target from memory), so blocks are
+   compiled one at a time, as the engine decides to: entry[pc] starts out as a stub, and is replaced
+   by the block when it's compiled.
+
+   Compiling a block runs it on what is known when compiling, rather than on the values themselves.
+   What is known about the accumulator, or a cell, is that it is a constant, or a cell's value (in
+   memory, right now) plus a constant, or the value in acc (the host register) plus a constant. So:
+     - Nothing is done for G, I and S, or for A and s with a constant. The value is only put into acc
+       when something needs it there, and "G0 I2" then becomes one acc = MEM[0] + 2.
+     - A store doesn't go to memory until something needs it to be there: a load or store through a
+       pointer that could be that cell, a change to what it was stored from, or the end of the block.
+       If the cell is stored to again before that, the first store is never done at all.
+     - A load through a pointer, or a jump, with a constant address becomes a plain one.
+     - A branch on an accumulator that is known becomes nothing, or, if it is taken, the block carries
+       on from its target: "S0 B80" is compiled to nothing at all.
+     - Storing a pointer, loading through it, and branching on what was loaded, is one operation.
+   A store through a pointer that isn't known could go anywhere, so everything known about memory is
+   forgotten after one.
+
+   One rule keeps this simple: nothing known refers to a cell's value in memory while that cell has a
+   store waiting, as memory isn't what the program thinks is there. A store to a cell first puts
+   anything that does into acc or memory. Then, writing out the waiting stores never changes a value
+   something else depends on, and the order they are written out in doesn't matter.
+
+   An engine includes this after defining MEM, loads the program into roi and rod, points entry[] at
+   its stubs with blockInit, and starts the block at entry[0]. When the stub for a block that isn't
+   compiled runs, it can compile it (compile() is for one thread at a time), or return, leaving the
+   pc to go on from in blockPc and acc in blockAcc. D returns, with blockPc -1. A compiled block is
+   published with a release store to entry[], so compiling can happen on another thread.
+*/
+
+#ifndef GORBIT_BB_H
+#define GORBIT_BB_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "GORBIT-IO.h"
+#include "GORBIT-TAIL.h"
+
+   // A block is compiled from at most this many instructions (counting those jumped back to). Each
+   // of them emits at most one operation of its own, one putting acc in the register, and the store it
+   // left waiting, and leaving the block takes two more.
+#define BLOCK_INSNS MEM
+#define BLOCK_OPS (4 * BLOCK_INSNS + 4)
+
+#define BLOCK_NEXT \
+   TAIL_CALL ip->handler(ip, rwd, acc);
+
+#define BLOCK_DISPATCH \
+   ++ip; \
+   BLOCK_NEXT
+
+#define BLOCK_EXIT(pc) \
+   ip = atomic_load_explicit(&entry[pc], memory_order_acquire); \
+   BLOCK_NEXT
+
+struct op;
+
+typedef void (TAIL_CC * handler)(const struct op * ip, unsigned char * rwd, unsigned char acc);
+
+struct op
+ {
+   handler handler;
+   unsigned char x, k, y;
+   unsigned char target, next;   // Where a branch goes, if it's taken or not.
+ };
+
+static unsigned char roi [MEM], rod [MEM];
+static _Atomic(const struct op *) entry [MEM];
+static struct op stubs [MEM];
+
+   // Where the blocks returned to the engine: -1 after D, or what the engine's stub left.
+static int blockPc;
+static unsigned char blockAcc;
+
+   // Operations the compiler emits. X and Y are cells, K is a constant.
+
+TAIL_HANDLER void Set (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc = ip->k;
+
+   BLOCK_DISPATCH
+ }
+
+   // acc = MEM[X] + K
+TAIL_HANDLER void Load (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc = rwd[ip->x] + ip->k;
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void AddK (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc += ip->k;
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void Add (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc += rwd[ip->x];
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void Xor (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc ^= rwd[ip->x];
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void LoadI (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc = rwd[rwd[ip->x]];
+
+   BLOCK_DISPATCH
+ }
+
+   // MEM[X] = MEM[Y] + K, then acc = MEM[MEM[X]]: storing a pointer, and loading through it.
+TAIL_HANDLER void CopyLoadI (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   unsigned char pointer = rwd[ip->y] + ip->k;
+
+   rwd[ip->x] = pointer;
+   acc = rwd[pointer];
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void AddI (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc += rwd[rwd[ip->x]];
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void Input (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc = ioGet();
+
+   BLOCK_DISPATCH
+ }
+
+   // MEM[X] = acc + K
+TAIL_HANDLER void Store (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   rwd[ip->x] = acc + ip->k;
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void StoreK (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   rwd[ip->x] = ip->k;
+
+   BLOCK_DISPATCH
+ }
+
+   // MEM[X] = MEM[Y] + K
+TAIL_HANDLER void Copy (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   rwd[ip->x] = rwd[ip->y] + ip->k;
+
+   BLOCK_DISPATCH
+ }
+
+   // MEM[MEM[X]] = acc + K
+TAIL_HANDLER void StoreI (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   rwd[rwd[ip->x]] = acc + ip->k;
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void StoreIK (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   rwd[rwd[ip->x]] = ip->k;
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void Inc (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   rwd[ip->x] += acc;
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void InputM (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   rwd[ip->x] = ioGet();
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void Out (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   ioPut(acc);
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void OutK (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   ioPut(ip->k);
+
+   BLOCK_DISPATCH
+ }
+
+TAIL_HANDLER void OutM (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   ioPut(rwd[ip->x]);
+
+   BLOCK_DISPATCH
+ }
+
+   // BRZ target, or on to next: the end of a block, and acc is what the next one starts with.
+TAIL_HANDLER void Brz (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   if (0 == acc)
+    {
+      BLOCK_EXIT(ip->target)
+    }
+   BLOCK_EXIT(ip->next)
+ }
+
+   // LoadI, then Brz.
+TAIL_HANDLER void LoadIBrz (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc = rwd[rwd[ip->x]];
+   if (0 == acc)
+    {
+      BLOCK_EXIT(ip->target)
+    }
+   BLOCK_EXIT(ip->next)
+ }
+
+   // CopyLoadI, then Brz: all of "Gx Ik Oy gy Bn".
+TAIL_HANDLER void CopyLoadIBrz (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   unsigned char pointer = rwd[ip->y] + ip->k;
+
+   rwd[ip->x] = pointer;
+   acc = rwd[pointer];
+   if (0 == acc)
+    {
+      BLOCK_EXIT(ip->target)
+    }
+   BLOCK_EXIT(ip->next)
+ }
+
+   // Brz, to MEM[X].
+TAIL_HANDLER void BrzM (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   if (0 == acc)
+    {
+      BLOCK_EXIT(rwd[ip->x])
+    }
+   BLOCK_EXIT(ip->next)
+ }
+
+TAIL_HANDLER void Jump (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   BLOCK_EXIT(ip->target)
+ }
+
+   // K is the pc of the illegal instruction.
+TAIL_HANDLER void E (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   (void) rwd;
+   ioFlush();
+   printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", ip->k, acc, roi[ip->k], rod[ip->k]);
+   exit(1);
+ }
+
+TAIL_HANDLER void D (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   (void) ip; (void) rwd;
+   blockPc = -1;
+   blockAcc = acc;
+   return;
+ }
+
+   // What compile() knows about a value.
+#define CONST 0  // It is k.
+#define CELL  1  // It is MEM[cell] + k, with MEM as it is in memory.
+#define ACC   2  // It is acc + k, with acc as it is in the register.
+
+struct value
+ {
+   int kind;
+   unsigned char cell, k;
+ };
+
+   // The state of compile(): what it knows, and what it has emitted.
+static struct value accumulator;
+static struct value cells [MEM];
+static unsigned char known [MEM];   // cells[] says something. Without a waiting store, it is a CONST.
+static unsigned char waiting [MEM]; // There is a store waiting to be done, of cells[].
+static struct op block [BLOCK_OPS];
+static int size;
+
+   // Emit an operation, folding a load through a pointer into the store of that pointer before it.
+void emit (handler handler, int x, int k, int y)
+ {
+   if ((LoadI == handler) && (0 != size) && (Copy == block[size - 1].handler) && (x == block[size - 1].x))
+    {
+      block[size - 1].handler = CopyLoadI;
+      return;
+    }
+   block[size].handler = handler;
+   block[size].x = x;
+   block[size].k = k;
+   block[size].y = y;
+   ++size;
+ }
+
+   // Emit the end of the block, folding the load of what Brz tests into it.
+void emitBranch (handler handler, int x, int target, int next)
+ {
+   if ((Brz == handler) && (0 != size) && (LoadI == block[size - 1].handler))
+    {
+      --size;
+      handler = LoadIBrz;
+    }
+   else if ((Brz == handler) && (0 != size) && (CopyLoadI == block[size - 1].handler))
+    {
+      --size;
+      handler = CopyLoadIBrz;
+    }
+   else
+    {
+      block[size].x = x;
+    }
+   block[size].handler = handler;
+   block[size].target = target;
+   block[size].next = next;
+   ++size;
+ }
+
+struct value constant (int k)
+ {
+   struct value result;
+
+   result.kind = CONST;
+   result.cell = 0;
+   result.k = k;
+   return result;
+ }
+
+   // Do cell's waiting store.
+void store (int cell)
+ {
+   struct value value = cells[cell];
+
+   if (CONST == value.kind)
+    {
+      emit(StoreK, cell, value.k, 0);
+    }
+   else if (CELL == value.kind)
+    {
+      emit(Copy, cell, value.k, value.cell);
+    }
+   else
+    {
+      emit(Store, cell, value.k, 0);
+    }
+   waiting[cell] = 0;
+   known[cell] = (CONST == value.kind);
+ }
+
+   // Do every waiting store, last's last, so that it's right before what uses it.
+void storeAll (int last)
+ {
+   int cell;
+
+   for (cell = 0; cell < MEM; ++cell)
+    {
+      if (waiting[cell] && (cell != last))
+       {
+         store(cell);
+       }
+    }
+   if ((last >= 0) && waiting[last])
+    {
+      store(last);
+    }
+ }
+
+   // Get ready for acc to change: do the waiting stores that are of it.
+void freeAcc (void)
+ {
+   int cell;
+
+   for (cell = 0; cell < MEM; ++cell)
+    {
+      if (waiting[cell] && (ACC == cells[cell].kind))
+       {
+         store(cell);
+       }
+    }
+ }
+
+   // Put the accumulator in acc.
+void materialize (void)
+ {
+   int cell;
+
+   if (ACC == accumulator.kind)
+    {
+      if (0 != accumulator.k)
+       {
+         emit(AddK, 0, accumulator.k, 0);
+         for (cell = 0; cell < MEM; ++cell)
+          {
+            if (waiting[cell] && (ACC == cells[cell].kind))
+             {
+               cells[cell].k -= accumulator.k;
+             }
+          }
+       }
+    }
+   else
+    {
+      freeAcc();
+      if (CONST == accumulator.kind)
+       {
+         emit(Set, 0, accumulator.k, 0);
+       }
+      else
+       {
+         emit(Load, accumulator.cell, accumulator.k, 0);
+       }
+    }
+   accumulator.kind = ACC;
+   accumulator.k = 0;
+ }
+
+   // Get ready for cell to change in memory (or to get a waiting store): anything that depends on it
+   // being what it is now is put somewhere else.
+void clobber (int cell)
+ {
+   int other;
+
+   if ((CELL == accumulator.kind) && (cell == accumulator.cell))
+    {
+      materialize();
+    }
+   for (other = 0; other < MEM; ++other)
+    {
+      if (waiting[other] && (other != cell) && (CELL == cells[other].kind) && (cell == cells[other].cell))
+       {
+         store(other);
+       }
+    }
+ }
+
+   // Get ready for cell to be read from memory.
+void settle (int cell)
+ {
+   if (waiting[cell])
+    {
+      store(cell);
+    }
+ }
+
+   // What cell is. A cell whose waiting store is of its own value in memory is stored first, so that
+   // whatever this is given to doesn't depend on a cell with a waiting store.
+struct value fetch (int cell)
+ {
+   struct value result;
+
+   if (waiting[cell] && (CELL == cells[cell].kind) && (cell == cells[cell].cell))
+    {
+      store(cell);
+    }
+   if (known[cell])
+    {
+      return cells[cell];
+    }
+   result.kind = CELL;
+   result.cell = cell;
+   result.k = 0;
+   return result;
+ }
+
+   // MEM[cell] = value, later.
+void assign (int cell, struct value value)
+ {
+   if (!waiting[cell] && (CELL == value.kind) && (cell == value.cell) && (0 == value.k))
+    {
+      return;
+    }
+   if (known[cell] && !waiting[cell] && (CONST == value.kind) && (cells[cell].k == value.k))
+    {
+      return;
+    }
+   clobber(cell);
+   cells[cell] = value;
+   known[cell] = 1;
+   waiting[cell] = 1;
+ }
+
+   // Memory is about to change somewhere unknown, through the pointer in cell.
+void forget (int cell)
+ {
+   if (CELL == accumulator.kind)
+    {
+      materialize();
+    }
+   storeAll(cell);
+   memset(known, 0, sizeof(known));
+ }
+
+   // Leave the block: everything is put where the next one expects it.
+void leave (void)
+ {
+   materialize();
+   storeAll(-1);
+ }
+
+   // A or s of cell.
+void combine (int op, int cell)
+ {
+   struct value value = fetch(cell);
+
+   if ((CONST == accumulator.kind) && (CONST == value.kind))
+    {
+      if ('A' == op) accumulator.k += value.k;
+      else accumulator.k ^= value.k;
+    }
+   else if ((CONST == value.kind) && (('A' == op) || (0 == value.k)))
+    {
+      accumulator.k += value.k;
+    }
+   else if ((CONST == accumulator.kind) && (('A' == op) || (0 == accumulator.k)))
+    {
+      value.k += accumulator.k;
+      accumulator = value;
+    }
+   else
+    {
+      materialize();
+      freeAcc();
+      settle(cell);
+      emit(('A' == op) ? Add : Xor, cell, 0, 0);
+    }
+ }
+
+   // BRZ target, from pc. Returns where the block goes on from, or -1 if it ends here.
+int branch (int target, int pc)
+ {
+   if (CONST != accumulator.kind)
+    {
+      leave();
+      emitBranch(Brz, 0, target, pc + 1);
+      return -1;
+    }
+   return (0 == accumulator.k) ? target : pc + 1;
+ }
+
+const struct op * compile (int start)
+ {
+   struct value value;
+   struct op * result;
+   int pc, count, cell, k;
+
+   accumulator.kind = ACC;
+   accumulator.cell = 0;
+   accumulator.k = 0;
+   memset(known, 0, sizeof(known));
+   memset(waiting, 0, sizeof(waiting));
+   size = 0;
+
+   pc = start;
+   for (count = 0; -1 != pc; ++count)
+    {
+      if (BLOCK_INSNS == count)
+       {
+         leave();
+         emitBranch(Jump, 0, pc, 0);
+         break;
+       }
+
+      cell = rod[pc];
+      switch (roi[pc])
+       {
+      case 'G':
+         accumulator = fetch(cell);
+         ++pc;
+         break;
+      case 'O':
+         assign(cell, accumulator);
+         ++pc;
+         break;
+      case 'R':
+         freeAcc();
+         emit(Input, 0, 0, 0);
+         accumulator.kind = ACC;
+         accumulator.k = 0;
+         ++pc;
+         break;
+      case 'B':
+         pc = branch(cell, pc);
+         break;
+      case 'I':
+         accumulator.k += cell;
+         ++pc;
+         break;
+      case 'T':
+         if (CONST == accumulator.kind)
+          {
+            emit(OutK, 0, accumulator.k, 0);
+          }
+         else
+          {
+            materialize();
+            emit(Out, 0, 0, 0);
+          }
+         ++pc;
+         break;
+      case 'S':
+         accumulator = constant(cell);
+         ++pc;
+         break;
+      case 'A':
+      case 's':
+         combine(roi[pc], cell);
+         ++pc;
+         break;
+
+      case 'g':
+      case 'a':
+      case 'o':
+      case 'b':
+         value = fetch(cell);
+         if (CONST == value.kind)
+          {
+               // A known pointer: it's the instruction without the indirection.
+            switch (roi[pc])
+             {
+            case 'g':
+               accumulator = fetch(value.k);
+               ++pc;
+               break;
+            case 'a':
+               combine('A', value.k);
+               ++pc;
+               break;
+            case 'o':
+               assign(value.k, accumulator);
+               ++pc;
+               break;
+            case 'b':
+               pc = branch(value.k, pc);
+               break;
+             }
+          }
+         else if ('g' == roi[pc])
+          {
+            storeAll(cell);
+            emit(LoadI, cell, 0, 0);
+            accumulator.kind = ACC;
+            accumulator.k = 0;
+            ++pc;
+          }
+         else if ('a' == roi[pc])
+          {
+            materialize();
+            storeAll(cell);
+            emit(AddI, cell, 0, 0);
+            ++pc;
+          }
+         else if ('o' == roi[pc])
+          {
+            forget(cell);
+            if (CONST == accumulator.kind)
+             {
+               emit(StoreIK, cell, accumulator.k, 0);
+             }
+            else
+             {
+               emit(StoreI, cell, accumulator.k, 0);
+             }
+            ++pc;
+          }
+         else if ((CONST == accumulator.kind) && (0 != accumulator.k))
+          {
+            ++pc;
+          }
+         else
+          {
+            leave();
+            emitBranch(BrzM, cell, 0, pc + 1);
+            pc = -1;
+          }
+         break;
+      case 'r':
+         waiting[cell] = 0;
+         known[cell] = 0;
+         clobber(cell);
+         emit(InputM, cell, 0, 0);
+         ++pc;
+         break;
+      case 'i':
+         value = fetch(cell);
+         if (CONST == accumulator.kind)
+          {
+            value.k += accumulator.k;
+            assign(cell, value);
+          }
+         else if (CONST == value.kind)
+          {
+            k = value.k;
+            value = accumulator;
+            value.k += k;
+            assign(cell, value);
+          }
+         else
+          {
+            materialize();
+            settle(cell);
+            clobber(cell);
+            emit(Inc, cell, 0, 0);
+            known[cell] = 0;
+          }
+         ++pc;
+         break;
+      case 't':
+         value = fetch(cell);
+         if (CONST == value.kind)
+          {
+            emit(OutK, 0, value.k, 0);
+          }
+         else
+          {
+            settle(cell);
+            emit(OutM, cell, 0, 0);
+          }
+         ++pc;
+         break;
+
+      case 'D':
+         emit(D, 0, 0, 0);
+         pc = -1;
+         break;
+      default:
+         materialize();
+         emit(E, 0, pc, 0);
+         pc = -1;
+         break;
+       }
+    }
+
+   result = malloc(size * sizeof(struct op));
+   if (NULL == result)
+    {
+      printf("out of memory\n");
+      exit(5);
+    }
+   memcpy(result, block, size * sizeof(struct op));
+   return result;
+ }
+
+   // Point every entry at a stub that runs handler, with K its pc.
+void blockInit (handler stub)
+ {
+   int pc;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      stubs[pc].handler = stub;
+      stubs[pc].k = pc;
+      atomic_store_explicit(&entry[pc], stubs + pc, memory_order_relaxed);
+    }
+ }
+
+#endif /* GORBIT_BB_H */
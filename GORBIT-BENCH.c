@@ -0,0 +1,808 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   This is the benchmark driver. It does what the README describes doing by hand:
+      Build every engine at every optimization level. (It asks make for them, so the flags are
+         the ones in the Makefile: the flavors are O0, Og, O2, O3, lto, and pgo.)
+      Run the synthetic benchmark on each one, pinned to one CPU, after a warmup run.
+      Keep running until the 95% confidence interval of the mean is within 1% of the mean.
+         (Or until we give up: some machines are just noisy.)
+      Normalize the results with respect to the fastest.
+
+   The ROM engines run Bench.txt. The RAM engines can't: Ackermann doesn't fit into RAM.
+   So, they run RAMBench.txt, which is just nested count-down loops, and they are normalized
+   separately. Comparing the two tables against each other would be meaningless.
+
+   An engine that doesn't exit normally is reported as such, rather than timed.
+   (The TCO engines at -O0 and -Og, for instance.)
+
+   GORBIT-ROM-AOT isn't an engine, but the ROM program translated to C and compiled. make builds it
+   from the program's name: Bench.txt becomes <flavor>/Bench-AOT. It's in the ROM table, since it's
+   running the same program. GORBIT-ROM-ELF is the same program compiled by GORBIT-ROM-ELF, as
+   <flavor>/Bench-ELF, which is the same executable whatever the flavor.
+
+   With -H, nothing is timed. Instead, after the warmups, each engine runs once with hardware counters
+   on it, through perf_event_open: cycles, instructions, branch misses, indirect branch misses, and L1
+   instruction cache misses, each divided by the number of GORBITSA instructions the program executes
+   (which the driver finds by running the program itself, once). That is the theory at the top of the
+   engines, about predicting the next instruction, measured. There's no generic event for indirect
+   branch misses, so that one is the raw event given with -I, which depends on the CPU: 0xe489
+   (BR_MISP_EXEC.INDIRECT) on Skylake, for instance, or 0xca on AMD Zen. A counter the kernel won't
+   give (there's no PMU in most virtual machines, and perf_event_paranoid may forbid it) is shown as -.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define MAX_RESULTS 256
+#define MAX_LEVELS 8
+#define MEM 256
+#define COUNTERS 5
+
+struct engine
+ {
+   const char * name;
+   int ram;
+   int aot;       // build the ROM program itself, rather than an engine that runs it: 1 through C, 2 straight to ELF
+ };
+
+struct result
+ {
+   const char * engine;
+   const char * level;
+   int ram;
+   int runs;
+   int failed;    // 0: timed, 1: did not exit normally, 2: did not build
+   double mean;
+   double ci;
+   double perInsn [COUNTERS]; // -H: each counter per GORBITSA instruction, or negative if it wasn't counted
+ };
+
+struct counter
+ {
+   const char * name;
+   unsigned int type;
+   unsigned long long config;
+ };
+
+   // What -H counts. The indirect branch misses are only counted with -I, which sets the raw event.
+#define INDIRECT 3
+static struct counter counters [COUNTERS] =
+ {
+   { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+   { "instrs", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+   { "br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+   { "ind-miss", PERF_TYPE_RAW, 0 },
+   { "L1i-miss", PERF_TYPE_HW_CACHE,
+      PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+ };
+
+static const struct engine engines [] =
+ {
+   { "GORBIT-ROM", 0, 0 },
+   { "GORBIT-ROM-2", 0, 0 },
+   { "GORBIT-ROM-TCO", 0, 0 },
+   { "GORBIT-ROM-CG", 0, 0 },
+   { "GORBIT-ROM-SW", 0, 0 },
+   { "GORBIT-ROM-TCO-SI", 0, 0 },
+   { "GORBIT-ROM-CG-SI", 0, 0 },
+   { "GORBIT-ROM-DT", 0, 0 },
+   { "GORBIT-ROM-TCO-16", 0, 0 },
+   { "GORBIT-ROM-BB", 0, 0 },
+   { "GORBIT-ROM-TIER", 0, 0 },
+   { "GORBIT-ROM-JIT", 0, 0 },
+   { "GORBIT-ROM-CP", 0, 0 },
+   { "GORBIT-ROM-MEMO", 0, 0 },
+   { "GORBIT-ROM-AOT", 0, 1 },
+   { "GORBIT-ROM-ELF", 0, 2 },
+   { "GORBIT-RAM", 1, 0 },
+   { "GORBIT-RAM-TCO", 1, 0 },
+   { "GORBIT-RAM-DT", 1, 0 },
+   { NULL, 0, 0 }
+ };
+
+static const char * levels [] = { "O0", "Og", "O2", NULL };
+
+static const char * compiler = NULL;
+static const char * builddir = "build";
+static const char * romProgram = "Bench.txt";
+static const char * ramProgram = "RAMBench.txt";
+static const char * inputFile = "/dev/null";
+static int cpu = 0;
+static int warmups = 1;
+static int minRuns = 10;
+static int maxRuns = 50;
+static double target = 0.01;
+static int hardware = 0;
+static int indirect = 0;
+static int counterError = 0;  // Why the first counter that couldn't be opened wasn't.
+
+   // Two-sided 95% critical values of Student's t, indexed by degrees of freedom.
+static const double tTable [] =
+ {
+   0.0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+ };
+
+static double tValue (int df)
+ {
+   if (df < (int) (sizeof(tTable) / sizeof(tTable[0])))
+    {
+      return tTable[df];
+    }
+   return 1.960;
+ }
+
+static double now (void)
+ {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+ }
+
+static int waitFor (pid_t child)
+ {
+   int status;
+
+   if (-1 == waitpid(child, &status, 0))
+    {
+      return -1;
+    }
+   if (WIFEXITED(status))
+    {
+      return WEXITSTATUS(status);
+    }
+   return -1;
+ }
+
+   // Build an engine, or the ROM program translated to C, and say where make put it.
+static int build (const struct engine * engine, const char * level, char * binary, size_t size)
+ {
+   char buildvar [256], ccvar [256];
+   size_t length;
+   pid_t child;
+
+   if (engine->aot)
+    {
+      length = strlen(romProgram);
+      if ((length > 4) && (0 == strcmp(romProgram + length - 4, ".txt"))) length -= 4;
+      snprintf(binary, size, "%s/%s/%.*s-%s", builddir, level, (int) length, romProgram, (2 == engine->aot) ? "ELF" : "AOT");
+    }
+   else
+    {
+      snprintf(binary, size, "%s/%s/%s", builddir, level, engine->name);
+    }
+   snprintf(buildvar, sizeof(buildvar), "BUILD=%s", builddir);
+
+   child = fork();
+   if (0 == child)
+    {
+         // The Makefile doesn't know which compiler built what's already there, so with another
+         // one, everything is built again (-B), rather than timing what the last one built.
+      if (NULL != compiler)
+       {
+         snprintf(ccvar, sizeof(ccvar), "CC=%s", compiler);
+         execlp("make", "make", "-s", "-B", buildvar, ccvar, binary, (char *) NULL);
+       }
+      else
+       {
+         execlp("make", "make", "-s", buildvar, binary, (char *) NULL);
+       }
+      _exit(127);
+    }
+   if (-1 == child)
+    {
+      return -1;
+    }
+   return waitFor(child);
+ }
+
+   // In the child: pin it, give it its input, throw away its output, and run the engine.
+static void execute (const char * binary, const char * program)
+ {
+   cpu_set_t set;
+   int fd;
+
+   CPU_ZERO(&set);
+   CPU_SET(cpu, &set);
+   sched_setaffinity(0, sizeof(set), &set);
+
+   fd = open(inputFile, O_RDONLY);
+   if (-1 != fd)
+    {
+      dup2(fd, 0);
+    }
+   fd = open("/dev/null", O_WRONLY);
+   if (-1 != fd)
+    {
+      dup2(fd, 1);
+    }
+
+   execl(binary, binary, program, (char *) NULL);
+   _exit(127);
+ }
+
+   // Run the program once, returning the wall time or a negative number on failure.
+static double runOnce (const char * binary, const char * program)
+ {
+   pid_t child;
+   double start, stop;
+
+   start = now();
+   child = fork();
+   if (0 == child)
+    {
+      execute(binary, program);
+    }
+   if (-1 == child)
+    {
+      return -1.0;
+    }
+   if (0 != waitFor(child))
+    {
+      return -1.0;
+    }
+   stop = now();
+
+   return stop - start;
+ }
+
+static void measure (struct result * res, const char * binary, const char * program)
+ {
+   double sum, sumsq, time, var;
+   int i;
+
+   res->runs = 0;
+   res->failed = 0;
+
+   for (i = 0; i < warmups; ++i)
+    {
+      if (runOnce(binary, program) < 0.0)
+       {
+         res->failed = 1;
+         return;
+       }
+    }
+
+   sum = 0.0;
+   sumsq = 0.0;
+   while (res->runs < maxRuns)
+    {
+      time = runOnce(binary, program);
+      if (time < 0.0)
+       {
+         res->failed = 1;
+         return;
+       }
+      sum += time;
+      sumsq += time * time;
+      ++res->runs;
+
+      res->mean = sum / res->runs;
+      if (res->runs > 1)
+       {
+         var = (sumsq - sum * res->mean) / (res->runs - 1);
+         if (var < 0.0) var = 0.0;
+         res->ci = tValue(res->runs - 1) * sqrt(var / res->runs);
+       }
+      else
+       {
+         res->ci = res->mean;
+       }
+
+      if ((res->runs >= minRuns) && (res->ci <= target * res->mean))
+       {
+         break;
+       }
+    }
+ }
+
+   // How many GORBITSA instructions the program executes, for -H to divide by, or 0 if it can't say.
+   // This runs the program once, on the same input as the engines, with about the simplest engine
+   // there is. For ROM, imm is rod; for RAM, imm and mem are both rwd, imm one past the opcode.
+static unsigned long long countInstructions (const char * program, int ram)
+ {
+   unsigned char roi [MEM], rod [MEM], rwd [MEM];
+   unsigned char * op, * imm, * mem;
+   unsigned long long count;
+   int input, cur, pc, step, acc;
+   FILE * source;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      roi[pc] = 'D';
+      rod[pc] = 0;
+      rwd[pc] = 0;
+    }
+   step = ram ? 2 : 1;
+   op = ram ? rwd : roi;
+   imm = ram ? rwd + 1 : rod;
+   mem = rwd;
+
+   source = fopen(program, "r");
+   if (NULL == source)
+    {
+      return 0;
+    }
+   input = fgetc(source);
+   cur = 0;
+   while (EOF != input)
+    {
+      if (cur + step >= MEM)
+       {
+         fclose(source);
+         return 0;
+       }
+      op[cur] = input;
+      imm[cur] = 0;
+      input = fgetc(source);
+      while ((input >= '0') && (input <= '9'))
+       {
+         imm[cur] = imm[cur] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+      cur += step;
+    }
+   fclose(source);
+   if (ram && (cur < MEM))
+    {
+      op[cur] = 'D';
+    }
+
+   source = fopen(inputFile, "r");
+   count = 0;
+   acc = 0;
+   pc = 0;
+   while (pc < MEM - 1)
+    {
+      switch (op[pc])
+       {
+      case 'G': acc = mem[imm[pc]]; break;
+      case 'O': mem[imm[pc]] = acc; break;
+      case 'R': acc = (NULL == source) ? EOF : fgetc(source); break;
+      case 'B': if (0 == acc) pc = imm[pc] - step; break;
+      case 'I': acc += imm[pc]; break;
+      case 'T': break;
+      case 'S': acc = imm[pc]; break;
+      case 'A': acc += mem[imm[pc]]; break;
+      case 'g': acc = mem[mem[imm[pc]]]; break;
+      case 'o': mem[mem[imm[pc]]] = acc; break;
+      case 'r': mem[imm[pc]] = (NULL == source) ? EOF : fgetc(source); break;
+      case 'b': if (0 == acc) pc = mem[imm[pc]] - step; break;
+      case 'i': mem[imm[pc]] += acc; break;
+      case 't': break;
+      case 's': acc ^= mem[imm[pc]]; break;
+      case 'a': acc += mem[mem[imm[pc]]]; break;
+      case 'D': pc = MEM; continue;
+      default: count = 0; pc = MEM; continue;
+       }
+      acc &= 255;
+      pc += step;
+      ++count;
+    }
+   if (NULL != source)
+    {
+      fclose(source);
+    }
+   return count;
+ }
+
+   // Run the program once with the hardware counters on it, and divide what they counted by the
+   // GORBITSA instructions executed. Returns what waitFor does.
+static int runCounted (struct result * res, const char * binary, const char * program, unsigned long long executed)
+ {
+   struct perf_event_attr attr;
+   unsigned long long value [3]; // The count, and the time it was enabled and running, for scaling.
+   int fd [COUNTERS], ready [2], status, i;
+   pid_t child;
+   char go;
+
+   if (0 != pipe(ready))
+    {
+      return -1;
+    }
+   child = fork();
+   if (0 == child)
+    {
+         // Wait for the counters, which start at the exec.
+      close(ready[1]);
+      if (1 != read(ready[0], &go, 1))
+       {
+         _exit(127);
+       }
+      execute(binary, program);
+    }
+   close(ready[0]);
+   if (-1 == child)
+    {
+      close(ready[1]);
+      return -1;
+    }
+
+   for (i = 0; i < COUNTERS; ++i)
+    {
+      fd[i] = -1;
+      if ((INDIRECT == i) && !indirect)
+       {
+         continue;
+       }
+      memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = counters[i].type;
+      attr.config = counters[i].config;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      attr.disabled = 1;
+      attr.enable_on_exec = 1;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      fd[i] = syscall(SYS_perf_event_open, &attr, child, -1, -1, PERF_FLAG_FD_CLOEXEC);
+      if ((-1 == fd[i]) && (0 == counterError))
+       {
+         counterError = errno;
+       }
+    }
+
+   go = 1;
+   if (1 != write(ready[1], &go, 1))
+    {
+      kill(child, SIGKILL);
+    }
+   close(ready[1]);
+   status = waitFor(child);
+
+   for (i = 0; i < COUNTERS; ++i)
+    {
+      res->perInsn[i] = -1.0;
+      if (-1 == fd[i])
+       {
+         continue;
+       }
+      if ((sizeof(value) == read(fd[i], value, sizeof(value))) && (0 != value[2]) && (0 != executed))
+       {
+         res->perInsn[i] = value[0] * ((double) value[1] / value[2]) / executed;
+       }
+      close(fd[i]);
+    }
+   return status;
+ }
+
+   // -H's measure.
+static void measureCounters (struct result * res, const char * binary, const char * program, unsigned long long executed)
+ {
+   int i;
+
+   res->runs = 0;
+   res->failed = 0;
+   res->mean = 0.0;
+
+   for (i = 0; i < warmups; ++i)
+    {
+      if (runOnce(binary, program) < 0.0)
+       {
+         res->failed = 1;
+         return;
+       }
+    }
+   if (0 != runCounted(res, binary, program, executed))
+    {
+      res->failed = 1;
+      return;
+    }
+   res->runs = 1;
+ }
+
+static int compareResults (const void * lhs, const void * rhs)
+ {
+   const struct result * l = (const struct result *) lhs;
+   const struct result * r = (const struct result *) rhs;
+
+   if (l->failed != r->failed) return l->failed - r->failed;
+   if (l->mean < r->mean) return -1;
+   if (l->mean > r->mean) return 1;
+   return 0;
+ }
+
+static void report (struct result * results, int count, const char * title)
+ {
+   double fastest;
+   int i;
+
+   if (0 == count)
+    {
+      return;
+    }
+   qsort(results, count, sizeof(struct result), compareResults);
+   fastest = results[0].mean;
+
+   printf("\n%s\n", title);
+   printf("   %-24s %-6s %10s %8s %5s %12s\n", "Engine", "Flags", "Mean (s)", "95% CI", "Runs", "Time factor");
+   for (i = 0; i < count; ++i)
+    {
+      if (results[i].failed)
+       {
+         printf("   %-24s %-6s %10s %8s %5s %12s\n", results[i].engine, results[i].level, "-", "-", "-",
+            (1 == results[i].failed) ? "crashed" : "no build");
+       }
+      else
+       {
+         printf("   %-24s %-6s %10.3f %7.2f%% %5d %12.2f\n", results[i].engine, results[i].level,
+            results[i].mean, 100.0 * results[i].ci / results[i].mean, results[i].runs,
+            results[i].mean / fastest);
+       }
+    }
+ }
+
+static void reportCounters (struct result * results, int count, const char * title, unsigned long long executed)
+ {
+   int i, c;
+
+   if (0 == count)
+    {
+      return;
+    }
+
+   printf("\n%s: %llu instructions, counts are per instruction\n", title, executed);
+   printf("   %-24s %-6s", "Engine", "Flags");
+   for (c = 0; c < COUNTERS; ++c)
+    {
+      printf(" %9s", counters[c].name);
+    }
+   printf("\n");
+   for (i = 0; i < count; ++i)
+    {
+      printf("   %-24s %-6s", results[i].engine, results[i].level);
+      for (c = 0; c < COUNTERS; ++c)
+       {
+         if (results[i].failed)
+          {
+            printf(" %9s", (0 == c) ? ((1 == results[i].failed) ? "crashed" : "no build") : "");
+          }
+         else if (results[i].perInsn[c] < 0.0)
+          {
+            printf(" %9s", "-");
+          }
+         else
+          {
+            printf(" %9.3f", results[i].perInsn[c]);
+          }
+       }
+      printf("\n");
+    }
+ }
+
+static int selected (const char * name, char ** list, int count)
+ {
+   int i;
+
+   if (0 == count)
+    {
+      return 1;
+    }
+   for (i = 0; i < count; ++i)
+    {
+      if (0 == strcmp(name, list[i]))
+       {
+         return 1;
+       }
+    }
+   return 0;
+ }
+
+static void usage (void)
+ {
+   printf("usage: GORBIT-BENCH [options]\n");
+   printf("   -e engine     only benchmark this engine (repeatable)\n");
+   printf("   -l flavor     only use this build flavor: O0 Og O2 O3 lto pgo (repeatable)\n");
+   printf("   -p program    ROM benchmark program (default %s)\n", romProgram);
+   printf("   -P program    RAM benchmark program (default %s)\n", ramProgram);
+   printf("   -i file       standard input for each run (default %s)\n", inputFile);
+   printf("   -c cpu        CPU to pin runs to (default %d)\n", cpu);
+   printf("   -w count      warmup runs (default %d)\n", warmups);
+   printf("   -n count      minimum timed runs (default %d)\n", minRuns);
+   printf("   -N count      maximum timed runs (default %d)\n", maxRuns);
+   printf("   -t fraction   target CI half-width relative to the mean (default %.2f)\n", target);
+   printf("   -C compiler   compiler to build with, rebuilding everything (default: make's $CC)\n");
+   printf("   -d directory  make's BUILD directory (default %s)\n", builddir);
+   printf("   -H            count cycles, instructions, and misses per GORBITSA instruction instead of timing\n");
+   printf("   -I event      -H: the raw event for indirect branch misses on this CPU (e.g. 0xe489 on Skylake)\n");
+ }
+
+int main (int argc, char ** argv)
+ {
+   struct result romResults [MAX_RESULTS], ramResults [MAX_RESULTS];
+   int romCount, ramCount;
+   char * engineList [MAX_RESULTS];
+   const char * levelList [MAX_LEVELS + 1];
+   int engineCount, levelCount;
+   char binary [512];
+   struct result * res;
+   const char ** level;
+   unsigned long long romExecuted, ramExecuted;
+   int e, opt;
+
+   engineCount = 0;
+   levelCount = 0;
+   while (-1 != (opt = getopt(argc, argv, "e:l:p:P:i:c:w:n:N:t:C:d:HI:h")))
+    {
+      switch (opt)
+       {
+      case 'e':
+         if (engineCount < MAX_RESULTS) engineList[engineCount++] = optarg;
+         break;
+      case 'l':
+         if (levelCount < MAX_LEVELS) levelList[levelCount++] = optarg;
+         break;
+      case 'p':
+         romProgram = optarg;
+         break;
+      case 'P':
+         ramProgram = optarg;
+         break;
+      case 'i':
+         inputFile = optarg;
+         break;
+      case 'c':
+         cpu = atoi(optarg);
+         break;
+      case 'w':
+         warmups = atoi(optarg);
+         break;
+      case 'n':
+         minRuns = atoi(optarg);
+         break;
+      case 'N':
+         maxRuns = atoi(optarg);
+         break;
+      case 't':
+         target = atof(optarg);
+         break;
+      case 'C':
+         compiler = optarg;
+         break;
+      case 'd':
+         builddir = optarg;
+         break;
+      case 'H':
+         hardware = 1;
+         break;
+      case 'I':
+         counters[INDIRECT].config = strtoull(optarg, NULL, 0);
+         indirect = 1;
+         break;
+      default:
+         usage();
+         return 2;
+       }
+    }
+   levelList[levelCount] = NULL;
+   if (minRuns < 2) minRuns = 2;
+   if (maxRuns < minRuns) maxRuns = minRuns;
+
+   romCount = 0;
+   ramCount = 0;
+   romExecuted = 0;
+   ramExecuted = 0;
+   if (hardware)
+    {
+      fprintf(stderr, "counting the instructions %s executes\n", romProgram);
+      romExecuted = countInstructions(romProgram, 0);
+      fprintf(stderr, "counting the instructions %s executes\n", ramProgram);
+      ramExecuted = countInstructions(ramProgram, 1);
+    }
+   for (e = 0; NULL != engines[e].name; ++e)
+    {
+      if (!selected(engines[e].name, engineList, engineCount))
+       {
+         continue;
+       }
+      for (level = (0 != levelCount) ? levelList : levels; NULL != *level; ++level)
+       {
+         if (engines[e].ram)
+          {
+            res = &ramResults[ramCount++];
+          }
+         else
+          {
+            res = &romResults[romCount++];
+          }
+         res->engine = engines[e].name;
+         res->level = *level;
+         res->ram = engines[e].ram;
+
+         fprintf(stderr, "%s %s: ", res->engine, res->level);
+         if (0 != build(&engines[e], res->level, binary, sizeof(binary)))
+          {
+            fprintf(stderr, "build failed\n");
+            res->failed = 2;
+            res->runs = 0;
+            continue;
+          }
+         if (hardware)
+          {
+            measureCounters(res, binary, res->ram ? ramProgram : romProgram, res->ram ? ramExecuted : romExecuted);
+          }
+         else
+          {
+            measure(res, binary, res->ram ? ramProgram : romProgram);
+          }
+         if (res->failed)
+          {
+            fprintf(stderr, "did not exit normally\n");
+          }
+         else if (hardware && (res->perInsn[0] >= 0.0))
+          {
+            fprintf(stderr, "%.3f cycles per instruction\n", res->perInsn[0]);
+          }
+         else if (hardware)
+          {
+            fprintf(stderr, "ran, but the cycles weren't counted\n");
+          }
+         else
+          {
+            fprintf(stderr, "%.3f s +/- %.2f%% over %d runs\n", res->mean, 100.0 * res->ci / res->mean, res->runs);
+          }
+       }
+    }
+
+   if (hardware)
+    {
+      reportCounters(romResults, romCount, romProgram, romExecuted);
+      reportCounters(ramResults, ramCount, ramProgram, ramExecuted);
+      if (0 != counterError)
+       {
+         printf("\nSome counters couldn't be opened: %s.\n", strerror(counterError));
+       }
+      return 0;
+    }
+
+   report(romResults, romCount, romProgram);
+   report(ramResults, ramCount, ramProgram);
+
+   return 0;
+ }
@@ -0,0 +1,84 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   What GORBIT-ROM-CP and its stencils (GORBIT-ROM-CP-STENCILS.c) share.
+
+   A stencil is the machine code of one instruction's handler, as GCC compiled it, with holes where
+   the instruction's immediate and the code of the next instruction go. GORBIT-STENCIL turns the
+   object file of the stencils into a header of struct stencils, and GORBIT-ROM-CP copies one for
+   every instruction of the program and fills in its holes.
+
+   The stencils are called with MEM, ACC, and the context, which holds the I/O and error helpers
+   and where each instruction's code is (for b). So, like the JIT's code, the code holds no
+   addresses, and the holes are all either small constants or jumps within the code.
+
+   Both include this after defining MEM.
+*/
+
+#ifndef GORBIT_CP_H
+#define GORBIT_CP_H
+
+struct context;
+
+typedef void (* stencil) (unsigned char * rwd, unsigned int acc, const struct context * context);
+
+struct context
+ {
+   int (* get) (void);
+   int (* put) (int c);
+   void (* illegal) (const struct context * context, int pc, int acc);
+   const unsigned char * roi, * rod;
+   stencil code [MEM];
+ };
+
+   // What goes in a hole.
+#define HOLE_IMM    0  // The instruction's immediate.
+#define HOLE_PC     1  // Its PC.
+#define HOLE_NEXT   2  // The code of the instruction after it.
+#define HOLE_TARGET 3  // The code of the instruction its immediate names.
+
+struct hole
+ {
+   unsigned short offset;   // Of the four bytes to fill in, from the start of the stencil.
+   unsigned char what;      // HOLE_*
+   unsigned char relative;  // To the end of the hole (a jump), or not (a constant).
+   int addend;
+ };
+
+struct stencil
+ {
+   unsigned char op;
+   const unsigned char * code;
+   unsigned short size;
+   const struct hole * holes;
+   unsigned short numHoles;
+ };
+
+#endif /* GORBIT_CP_H */
@@ -0,0 +1,244 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   A cache of loaded programs, so that an engine started over and over on the same program only
+   has to read it once.
+
+   If GORBIT_CACHE names a directory, the engines keep an image of every program they load there:
+   roi and rod as the engine left them after loading, and, for the JIT, the code it generated. The
+   next time, the engine maps the image instead of parsing the program, and the JIT maps the code
+   and runs it instead of compiling.
+   Without GORBIT_CACHE, none of this happens.
+
+   An image is named for a hash of the program's text and of the engine's kind of image, so a
+   program that changes gets a new one, and engines that load differently don't share. "ROM" is
+   roi and rod as loadToMem leaves them (the superinstruction engines fuse a copy of that), and the
+   JIT's kind includes when it was built, as its code changes with it. The image starts with a
+   header holding roi and rod, and the code, if there is any, is at IMAGE_CODE, so that it can be
+   mapped on its own.
+
+   Images are written to a temporary name and renamed, so an engine never sees half of one. Nothing
+   ever removes them. As the JIT runs the code it finds in there, the directory should be one that
+   only you can write to.
+
+   An engine calls imageLoad in place of opening and loading the program. If it returns 0, the
+   engine loads the program itself, as usual, and then calls imageSave.
+*/
+
+#ifndef GORBIT_IMAGE_H
+#define GORBIT_IMAGE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define IMAGE_MAGIC "GORBITI2" // Changed when what the loaders leave in roi and rod does.
+#define IMAGE_CODE 4096  // Where the code starts: a page, for mmap.
+#define IMAGE_PATH 4096
+
+struct image
+ {
+   char magic [8];
+   unsigned long long key;       // The hash of the program and the kind.
+   unsigned long long size;      // The length of the program.
+   unsigned long long codeSize;  // Zero, if there isn't any.
+   unsigned char roi [MEM], rod [MEM];
+ };
+
+   // What imageSave needs after a miss.
+static char imagePath [IMAGE_PATH];
+static unsigned long long imageKey, imageSize;
+
+   // FNV-1a.
+static unsigned long long imageHash (unsigned long long hash, const unsigned char * data, size_t size)
+ {
+   size_t i;
+
+   for (i = 0; i < size; ++i)
+    {
+      hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+   return hash;
+ }
+
+   // Fill in roi and rod (and code and codeSize, if asked for and there is code) from the image of
+   // source, and return 1. Return 0 if there isn't one, and remember where it should go.
+static int imageLoad (const char * source, const char * kind, unsigned char * roi, unsigned char * rod,
+   const void ** code, size_t * codeSize)
+ {
+   const char * dir;
+   struct stat info;
+   const struct image * image;
+   void * text, * header, * map;
+   int fd, found;
+
+   imagePath[0] = '\0';
+   if (NULL != code)
+    {
+      *code = NULL;
+    }
+   dir = getenv("GORBIT_CACHE");
+   if ((NULL == dir) || ('\0' == dir[0]))
+    {
+      return 0;
+    }
+
+   fd = open(source, O_RDONLY);
+   if (fd < 0)
+    {
+      return 0;
+    }
+   if ((0 != fstat(fd, &info)) || !S_ISREG(info.st_mode))
+    {
+      close(fd);
+      return 0;
+    }
+   imageSize = info.st_size;
+   imageKey = 0xCBF29CE484222325ULL;
+   if (0 != imageSize)
+    {
+      text = mmap(NULL, imageSize, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (MAP_FAILED == text)
+       {
+         close(fd);
+         return 0;
+       }
+      imageKey = imageHash(imageKey, text, imageSize);
+      munmap(text, imageSize);
+    }
+   close(fd);
+   imageKey = imageHash(imageKey, (const unsigned char *) kind, strlen(kind) + 1);
+
+   if ((int) sizeof(imagePath) <= snprintf(imagePath, sizeof(imagePath), "%s/%016llx", dir, imageKey))
+    {
+      imagePath[0] = '\0';
+      return 0;
+    }
+
+   fd = open(imagePath, O_RDONLY);
+   if (fd < 0)
+    {
+      return 0;
+    }
+   found = 0;
+   if ((0 == fstat(fd, &info)) && (info.st_size >= (off_t) sizeof(struct image)))
+    {
+      header = mmap(NULL, sizeof(struct image), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (MAP_FAILED != header)
+       {
+         image = header;
+         if ((0 == memcmp(image->magic, IMAGE_MAGIC, sizeof(image->magic))) && (imageKey == image->key) &&
+            (imageSize == image->size))
+          {
+            found = 1;
+            if ((NULL != code) && (0 != image->codeSize))
+             {
+               found = 0;
+               if (info.st_size >= (off_t) (IMAGE_CODE + image->codeSize))
+                {
+                  map = mmap(NULL, image->codeSize, PROT_READ | PROT_EXEC, MAP_PRIVATE, fd, IMAGE_CODE);
+                  if (MAP_FAILED != map)
+                   {
+                     *code = map;
+                     *codeSize = image->codeSize;
+                     found = 1;
+                   }
+                }
+             }
+            if (found)
+             {
+               memcpy(roi, image->roi, MEM);
+               memcpy(rod, image->rod, MEM);
+             }
+          }
+         munmap(header, sizeof(struct image));
+       }
+    }
+   close(fd);
+
+   if (found)
+    {
+      imagePath[0] = '\0';
+    }
+   return found;
+ }
+
+   // After imageLoad returned 0 and the engine has loaded the program, write its image. It doesn't
+   // matter if this fails: the engine just loads the program again next time.
+static void imageSave (const unsigned char * roi, const unsigned char * rod, const void * code, size_t codeSize)
+ {
+   static const unsigned char zeros [IMAGE_CODE];
+   char temp [IMAGE_PATH + 32];
+   struct image image;
+   FILE * out;
+   int fd, ok;
+
+   if ('\0' == imagePath[0])
+    {
+      return;
+    }
+
+   memset(&image, 0, sizeof(image));
+   memcpy(image.magic, IMAGE_MAGIC, sizeof(image.magic));
+   image.key = imageKey;
+   image.size = imageSize;
+   image.codeSize = codeSize;
+   memcpy(image.roi, roi, MEM);
+   memcpy(image.rod, rod, MEM);
+
+   snprintf(temp, sizeof(temp), "%s.%ld", imagePath, (long) getpid());
+   fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+   if (fd < 0)
+    {
+      return;
+    }
+   out = fdopen(fd, "wb");
+   if (NULL == out)
+    {
+      close(fd);
+      unlink(temp);
+      return;
+    }
+   ok = (1 == fwrite(&image, sizeof(image), 1, out));
+   if (ok && (0 != codeSize))
+    {
+      ok = (1 == fwrite(zeros, IMAGE_CODE - sizeof(image), 1, out)) && (1 == fwrite(code, codeSize, 1, out));
+    }
+   if ((0 != fclose(out)) || !ok || (0 != rename(temp, imagePath)))
+    {
+      unlink(temp);
+    }
+ }
+
+#endif /* GORBIT_IMAGE_H */
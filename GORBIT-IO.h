@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   The engines' I/O, in place of getchar and putchar.
+
+   Each R, r, T, and t was a call into stdio, which locks and unlocks the stream, and (in the TCO
+   engines) is a call in the middle of the chain of tail calls. Here, each one is an inline test and
+   a byte copy, and the system calls happen a buffer at a time.
+
+   Output goes into a buffer, which is written out when it is full, when the engine has to wait for
+   input (so a prompt shows up before the program waits for the answer), and at exit. An engine that
+   prints something itself with stdio, like the illegal instruction message, has to call ioFlush
+   first, so that it comes out after the program's output.
+
+   If stdin is a regular file, it is mapped, and reading is just taking the next byte of it.
+   Otherwise, it is read a buffer at a time. (read() returns whatever there is, so a terminal
+   still gets a line at a time.)
+
+   None of this is locked, as the engines are single threaded. Building with -DGORBIT_STDIO
+   uses getchar_unlocked and putchar_unlocked instead: stdio's buffers, without stdio's locks.
+
+   An engine includes this, calls ioInit at the start of main, and then uses ioGet and ioPut.
+*/
+
+#ifndef GORBIT_IO_H
+#define GORBIT_IO_H
+
+#include <stdio.h>
+
+#ifdef GORBIT_STDIO
+
+#define ioInit()
+#define ioFlush() fflush(stdout)
+#define ioGet() getchar_unlocked()
+#define ioPut(c) putchar_unlocked(c)
+
+#else
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define IO_BUFFER 65536
+
+static unsigned char ioOut [IO_BUFFER];
+static size_t ioOutSize;
+
+static unsigned char ioBuffer [IO_BUFFER];
+static const unsigned char * ioIn = ioBuffer;   // ioBuffer, or the mapped file
+static size_t ioInPos, ioInSize;
+
+static void ioFlush (void)
+ {
+   size_t done;
+   ssize_t wrote;
+
+   done = 0;
+   while (done < ioOutSize)
+    {
+      wrote = write(STDOUT_FILENO, ioOut + done, ioOutSize - done);
+      if (wrote > 0)
+       {
+         done += wrote;
+       }
+      else if ((wrote < 0) && (EINTR != errno))
+       {
+         break;
+       }
+    }
+   ioOutSize = 0;
+ }
+
+   // The rest of ioGet, for when the buffer is empty.
+static int ioFill (void)
+ {
+   ssize_t got;
+
+   if (ioIn != ioBuffer)
+    {
+      return EOF; // All of the mapped file has been read.
+    }
+
+   ioFlush();
+   do
+    {
+      got = read(STDIN_FILENO, ioBuffer, IO_BUFFER);
+    }
+   while ((got < 0) && (EINTR == errno));
+
+   if (got <= 0)
+    {
+      return EOF;
+    }
+   ioInPos = 1;
+   ioInSize = got;
+   return ioBuffer[0];
+ }
+
+static inline int ioGet (void)
+ {
+   if (ioInPos < ioInSize)
+    {
+      return ioIn[ioInPos++];
+    }
+   return ioFill();
+ }
+
+static inline int ioPut (int c)
+ {
+   if (IO_BUFFER == ioOutSize)
+    {
+      ioFlush();
+    }
+   ioOut[ioOutSize++] = c;
+   return c;
+ }
+
+static void ioInit (void)
+ {
+   struct stat info;
+   off_t at;
+   void * map;
+
+   atexit(ioFlush);
+
+      // Map from the start of the file, and start reading where the file offset is, as someone
+      // may have already read part of it.
+   if ((0 == fstat(STDIN_FILENO, &info)) && S_ISREG(info.st_mode) && (info.st_size > 0))
+    {
+      at = lseek(STDIN_FILENO, 0, SEEK_CUR);
+      if (at >= 0)
+       {
+         map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+         if (MAP_FAILED != map)
+          {
+            ioIn = map;
+            ioInPos = at;
+            ioInSize = info.st_size;
+          }
+       }
+    }
+ }
+
+#endif
+
+#endif /* GORBIT_IO_H */
@@ -0,0 +1,649 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   The x86-64 compiler of GORBIT-ROM-JIT and GORBIT-ROM-ELF.
+
+   The whole program (all 255 instructions that can execute) is translated up front into one
+   native function. The registers are:
+      rbx      ACC, zero-extended. Every write to it is a write to bl, or a 32-bit write to ebx.
+      rbp      MEM + 128, so that every cell is an 8-bit displacement away.
+      r12-r15  The (up to) four low cells that the program names most often.
+      (%rsp)   The context: the I/O and error helpers, which are called indirectly through it.
+   All of these are callee-saved, so calling the helpers doesn't disturb them.
+
+   B becomes a test and a conditional jump. b becomes an indirect jump through a table of 256
+   offsets, one per instruction. The code doesn't contain any absolute addresses: the helpers are
+   reached through the context and the table is RIP-relative and holds offsets. So, it can be
+   copied anywhere and run.
+
+   Programs keep their stack pointers and temporaries in low cells, and a cell that was stored two
+   instructions ago is reloaded from MEM by way of store forwarding, which is slow. So, the cached
+   cells live in their registers, and MEM is out of date for them. Every direct access to one
+   (Gx, Ox, ix, and the rest) knows at compile time that it's cached. The indirect accesses (g, o,
+   a) first compare the address against the highest cached cell and, in the rare case that it's
+   at or below it, go out of line: write the registers back to MEM, do the access there, and reload
+   them. The registers are also written back when the program ends.
+
+   The other optimization is keeping track of what's known about ACC: that it's equal to a cell
+   (after Gx or Ox), equal to a constant (after Sk, or Ik after that), or that the flags reflect it
+   (after I, A, s, a, and the test of a B that wasn't taken). Instructions that don't change ACC
+   pass that along. So, "Gx Ik Oy gy" becomes
+      movzbl   x-128(%rbp), %ebx
+      add      $k, %bl
+      mov      %bl, y-128(%rbp)
+      movzbl   -128(%rbp,%rbx), %ebx
+   rather than reloading y, and "S0 Bn" becomes a jmp. But any instruction can be the target of a
+   b, and a branch into the middle doesn't know what came before. So, every instruction compiled
+   knowing something gets an entry out of line, which is what the branches go to. That translates
+   the following instructions knowing nothing, until what it knows is at least what the main line
+   knew there, and then joins the main line.
+
+   An engine includes this after defining MEM, points jit.code at CODE_SIZE bytes, and calls
+   compile(). The code it leaves there is a function that takes MEM and a context, and the context
+   starts with three pointers, at CONTEXT_GET, CONTEXT_PUT, and CONTEXT_ILLEGAL: get (which returns
+   the character, or EOF), put (the character), and illegal (the context, the pc, and ACC). They are
+   called with the stack aligned, as C functions, and have to keep the callee-saved registers.
+*/
+
+#ifndef GORBIT_JIT_H
+#define GORBIT_JIT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CODE_SIZE 262144
+#define MAX_FIXUPS 2048
+#define MAX_GUARDS 2048
+#define MAX_CACHED 4
+#define CACHE_LIMIT 16
+#define MAX_ENTRY 4     // Instructions in an entry before it gives up and jumps to the next one's.
+
+   // Branch targets that aren't instructions' entries.
+#define TARGET_EXIT  (MEM - 1)
+#define TARGET_TABLE MEM
+#define TARGET_MAIN  (MEM + 1)  // plus the pc: the main line, rather than the entry
+
+   // Register numbers, as the instruction encoding knows them.
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RBX 3
+#define RBP 5
+#define RDI 7
+#define R12 12
+
+   // Operand kinds for emitOp.
+#define IN_REGISTER 0   // a register
+#define IN_CELL     1   // cell(MEM)
+#define INDEXED     2   // -128(%rbp,register), which is MEM[register]
+
+   // Where the helpers are in the context.
+#define CONTEXT_GET     0
+#define CONTEXT_PUT     8
+#define CONTEXT_ILLEGAL 16
+
+
+   // What we know about ACC before an instruction.
+struct fact
+ {
+   int cell;      // ACC == MEM[cell], or -1
+   int constant;  // ACC == constant, or -1
+   int flags;     // ZF reflects ACC
+ };
+
+struct fixup
+ {
+   int pos;
+   int target;
+ };
+
+   // An indirect access that might hit a cached cell, and needs somewhere to go if it does.
+struct guard
+ {
+   int pos;       // of the jb's rel32
+   int resume;    // where to come back to
+   int address;   // the register holding the address
+   int store;     // whether it's an o, which the out of line code has to do itself
+ };
+
+struct jit
+ {
+   unsigned char * code;
+   int size;
+   int main [MEM];      // Where each instruction's main line code is; main[MEM - 1] is the exit.
+   int entry [MEM];     // Where branches to each instruction go.
+   int table;
+   int reg [MEM];       // The register that holds each cell, or -1.
+   int cells [MAX_CACHED];
+   int numCached;
+   int cacheEnd;        // One past the highest cached cell.
+   struct fixup fixups [MAX_FIXUPS];
+   int numFixups;
+   struct guard guards [MAX_GUARDS];
+   int numGuards;
+ };
+
+void emit1(struct jit * jit, int byte)
+ {
+   jit->code[jit->size++] = (unsigned char) byte;
+ }
+
+void emit4(struct jit * jit, int value)
+ {
+   emit1(jit, value);
+   emit1(jit, value >> 8);
+   emit1(jit, value >> 16);
+   emit1(jit, value >> 24);
+ }
+
+   // A cell's displacement from rbp.
+int disp(int cell)
+ {
+   return (cell - 128) & 0xFF;
+ }
+
+   // Emit an instruction with a ModRM byte: opcode (one byte, or 0x0F and one), a register, and an
+   // operand. This is the only place that has to think about REX prefixes. No byte register here
+   // is ever spl, bpl, sil, or dil, so a REX is only needed for r8-r15 (or a 64-bit operation).
+void emitOp(struct jit * jit, int wide, int opcode, int reg, int kind, int operand)
+ {
+   int rex;
+
+   rex = (wide ? 8 : 0) | ((reg >> 3) << 2);
+   if (IN_REGISTER == kind) rex |= operand >> 3;
+   if (INDEXED == kind) rex |= (operand >> 3) << 1;
+   if (0 != rex) emit1(jit, 0x40 | rex);
+   if (opcode > 0xFF) emit1(jit, opcode >> 8);
+   emit1(jit, opcode);
+
+   reg &= 7;
+   switch (kind)
+    {
+   case IN_REGISTER:
+      emit1(jit, 0xC0 | (reg << 3) | (operand & 7));
+      break;
+   case IN_CELL:
+      emit1(jit, 0x45 | (reg << 3));
+      emit1(jit, disp(operand));
+      break;
+   case INDEXED:
+      emit1(jit, 0x44 | (reg << 3));
+      emit1(jit, ((operand & 7) << 3) | RBP);
+      emit1(jit, 0x80);
+      break;
+    }
+ }
+
+   // Emit a rel32 to be filled in once we know where everything is.
+void emitTarget(struct jit * jit, int target)
+ {
+   if (MAX_FIXUPS == jit->numFixups)
+    {
+      printf("error, too many branches\n");
+      exit(5);
+    }
+   jit->fixups[jit->numFixups].pos = jit->size;
+   jit->fixups[jit->numFixups].target = target;
+   ++jit->numFixups;
+   emit4(jit, 0);
+ }
+
+void emitJump(struct jit * jit, int target)
+ {
+   emit1(jit, 0xE9);                            // jmp rel32
+   emitTarget(jit, target);
+ }
+
+void emitTest(struct jit * jit)
+ {
+   emit1(jit, 0x84); emit1(jit, 0xDB);          // test %bl, %bl
+ }
+
+void emitCall(struct jit * jit, int offset)
+ {
+   emit1(jit, 0x48); emit1(jit, 0x8B); emit1(jit, 0x04); emit1(jit, 0x24);   // mov (%rsp), %rax
+   emit1(jit, 0xFF); emit1(jit, 0x50); emit1(jit, offset);                    // call *offset(%rax)
+ }
+
+   // %reg = MEM[cell], zero-extended.
+void emitLoad(struct jit * jit, int reg, int cell)
+ {
+   if (-1 != jit->reg[cell])
+    {
+      emitOp(jit, 0, 0x89, jit->reg[cell], IN_REGISTER, reg);                  // mov %cached, %reg
+    }
+   else
+    {
+      emitOp(jit, 0, 0x0FB6, reg, IN_CELL, cell);                              // movzbl cell(MEM), %reg
+    }
+ }
+
+   // MEM[cell] = %reg, which is zero-extended.
+void emitStore(struct jit * jit, int reg, int cell)
+ {
+   if (-1 != jit->reg[cell])
+    {
+      emitOp(jit, 0, 0x89, reg, IN_REGISTER, jit->reg[cell]);                  // mov %reg, %cached
+    }
+   else
+    {
+      emitOp(jit, 0, 0x88, reg, IN_CELL, cell);                                // mov %reg, cell(MEM)
+    }
+ }
+
+   // Get MEM[cell], to use as an address, into a register, and say which one.
+int emitPointer(struct jit * jit, int cell, struct fact known)
+ {
+   if (known.cell == cell) return RBX;
+   if (-1 != jit->reg[cell]) return jit->reg[cell];
+   emitLoad(jit, RAX, cell);
+   return RAX;
+ }
+
+   // Before an indirect access through %address, go out of line if it could be a cached cell.
+   // Returns the guard, so that an o can say where to resume.
+int emitGuard(struct jit * jit, int address, int store)
+ {
+   if (0 == jit->numCached) return -1;
+   if (MAX_GUARDS == jit->numGuards)
+    {
+      printf("error, too many indirect accesses\n");
+      exit(5);
+    }
+   emitOp(jit, 0, 0x80, 7, IN_REGISTER, address); emit1(jit, jit->cacheEnd);  // cmp $cacheEnd, %address
+   emit1(jit, 0x0F); emit1(jit, 0x82);                                        // jb rel32
+   jit->guards[jit->numGuards].pos = jit->size;
+   emit4(jit, 0);
+   jit->guards[jit->numGuards].resume = jit->size;
+   jit->guards[jit->numGuards].address = address;
+   jit->guards[jit->numGuards].store = store;
+   return jit->numGuards++;
+ }
+
+   // Write the cached cells back to MEM, or reload them from it.
+void emitWriteBack(struct jit * jit)
+ {
+   int i;
+
+   for (i = 0; i < jit->numCached; ++i)
+    {
+      emitOp(jit, 0, 0x88, R12 + i, IN_CELL, jit->cells[i]);                 // mov %cached, cell(MEM)
+    }
+ }
+
+void emitReload(struct jit * jit)
+ {
+   int i;
+
+   for (i = 0; i < jit->numCached; ++i)
+    {
+      emitOp(jit, 0, 0x0FB6, R12 + i, IN_CELL, jit->cells[i]);               // movzbl cell(MEM), %cached
+    }
+ }
+
+   // Translate one instruction.
+void translate(struct jit * jit, int pc, unsigned char op, unsigned char imm, struct fact known)
+ {
+   int address, guard, skip;
+
+   switch (op)
+    {
+   case 'G':
+      if (known.cell != imm) emitLoad(jit, RBX, imm);
+      break;
+   case 'O':
+      if (known.cell != imm) emitStore(jit, RBX, imm);
+      break;
+   case 'R':
+      emitCall(jit, CONTEXT_GET);
+      emitOp(jit, 0, 0x0FB6, RBX, IN_REGISTER, RAX);                          // movzbl %al, %ebx
+      break;
+   case 'B':
+      if (-1 != known.constant)
+       {
+         if (0 == known.constant) emitJump(jit, imm);
+         break;
+       }
+      if (!known.flags) emitTest(jit);
+      emit1(jit, 0x0F); emit1(jit, 0x84);                                     // je rel32
+      emitTarget(jit, imm);
+      break;
+   case 'I':
+      if (-1 != known.constant)
+       {
+         emit1(jit, 0xBB); emit4(jit, (known.constant + imm) & 0xFF);         // mov $constant+imm, %ebx
+         break;
+       }
+      emit1(jit, 0x80); emit1(jit, 0xC3); emit1(jit, imm);                    // add $imm, %bl
+      break;
+   case 'T':
+      emit1(jit, 0x89); emit1(jit, 0xDF);                                     // mov %ebx, %edi
+      emitCall(jit, CONTEXT_PUT);
+      break;
+   case 'S':
+      emit1(jit, 0xBB); emit4(jit, imm);                                      // mov $imm, %ebx
+      break;
+   case 'A':
+      if (known.cell == imm)
+       {
+         emit1(jit, 0x00); emit1(jit, 0xDB);                                  // add %bl, %bl
+       }
+      else if (-1 != jit->reg[imm]) emitOp(jit, 0, 0x00, jit->reg[imm], IN_REGISTER, RBX);  // add %cached, %bl
+      else emitOp(jit, 0, 0x02, RBX, IN_CELL, imm);                                         // add imm(MEM), %bl
+      break;
+   case 'g':
+      address = emitPointer(jit, imm, known);
+      emitGuard(jit, address, 0);
+      emitOp(jit, 0, 0x0FB6, RBX, INDEXED, address);                          // movzbl MEM(%address), %ebx
+      break;
+   case 'o':
+      address = emitPointer(jit, imm, known);
+      guard = emitGuard(jit, address, 1);
+      emitOp(jit, 0, 0x88, RBX, INDEXED, address);                            // mov %bl, MEM(%address)
+      if (-1 != guard) jit->guards[guard].resume = jit->size;
+      break;
+   case 'r':
+      emitCall(jit, CONTEXT_GET);
+      emitOp(jit, 0, 0x0FB6, RAX, IN_REGISTER, RAX);                          // movzbl %al, %eax
+      emitStore(jit, RAX, imm);
+      break;
+   case 'b':
+      if ((-1 != known.constant) && (0 != known.constant)) break;
+      skip = 0;
+      if (-1 == known.constant)
+       {
+         if (!known.flags) emitTest(jit);
+         emit1(jit, 0x75); emit1(jit, 0);                                     // jne over the jump
+         skip = jit->size;
+       }
+      address = emitPointer(jit, imm, known);
+      emit1(jit, 0x48); emit1(jit, 0x8D); emit1(jit, 0x0D);                   // lea table(%rip), %rcx
+      emitTarget(jit, TARGET_TABLE);
+      emit1(jit, (address >= 8) ? 0x4A : 0x48); emit1(jit, 0x63);             // movslq (%rcx,%address,4), %rdx
+      emit1(jit, 0x14); emit1(jit, 0x80 | ((address & 7) << 3) | RCX);
+      emit1(jit, 0x48); emit1(jit, 0x01); emit1(jit, 0xCA);                   // add %rcx, %rdx
+      emit1(jit, 0xFF); emit1(jit, 0xE2);                                     // jmp *%rdx
+      if (0 != skip) jit->code[skip - 1] = jit->size - skip;
+      break;
+   case 'i':
+      if (-1 == jit->reg[imm]) emitOp(jit, 0, 0x00, RBX, IN_CELL, imm);       // add %bl, imm(MEM)
+      else if (-1 != known.constant)
+       {
+         emitOp(jit, 0, 0x80, 0, IN_REGISTER, jit->reg[imm]); emit1(jit, known.constant);    // add $constant, %cached
+       }
+      else emitOp(jit, 0, 0x00, RBX, IN_REGISTER, jit->reg[imm]);                                                   // add %bl, %cached
+      break;
+   case 't':
+      emitLoad(jit, RDI, imm);
+      emitCall(jit, CONTEXT_PUT);
+      break;
+   case 's':
+      if (known.cell == imm)
+       {
+         emit1(jit, 0x31); emit1(jit, 0xDB);                                  // xor %ebx, %ebx
+       }
+      else if (-1 != jit->reg[imm]) emitOp(jit, 0, 0x30, jit->reg[imm], IN_REGISTER, RBX);  // xor %cached, %bl
+      else emitOp(jit, 0, 0x32, RBX, IN_CELL, imm);                                         // xor imm(MEM), %bl
+      break;
+   case 'a':
+      address = emitPointer(jit, imm, known);
+      emitGuard(jit, address, 0);
+      emitOp(jit, 0, 0x02, RBX, INDEXED, address);                            // add MEM(%address), %bl
+      break;
+   case 'D':
+      emitJump(jit, TARGET_EXIT);
+      break;
+   default:
+      emit1(jit, 0xBE); emit4(jit, pc);                                       // mov $pc, %esi
+      emit1(jit, 0x89); emit1(jit, 0xDA);                                     // mov %ebx, %edx
+      emit1(jit, 0x48); emit1(jit, 0x8B); emit1(jit, 0x3C); emit1(jit, 0x24); // mov (%rsp), %rdi
+      emit1(jit, 0xFF); emit1(jit, 0x57); emit1(jit, CONTEXT_ILLEGAL);        // call *CONTEXT_ILLEGAL(%rdi)
+      break;
+    }
+ }
+
+   // What is known after an instruction, if the next one is reached by falling through.
+   // This has to agree with what translate() emits: in particular, which instructions touch the flags.
+struct fact learn(unsigned char op, unsigned char imm, struct fact known)
+ {
+   struct fact result;
+
+   result.cell = -1;
+   result.constant = -1;
+   result.flags = 0;
+
+   switch (op)
+    {
+   case 'G':
+      if (known.cell == imm) return known;
+      result.cell = imm;
+      break;
+   case 'O':
+      result = known;
+      result.cell = imm;
+      break;
+   case 'B':
+   case 'b':
+      result = known;
+      if (-1 == known.constant) result.flags = 1;
+      break;
+   case 'I':
+      if (-1 != known.constant) result.constant = (known.constant + imm) & 0xFF;
+      else result.flags = 1;
+      break;
+   case 'S':
+      result.constant = imm;
+      break;
+   case 's':
+      if (known.cell == imm) result.constant = 0;
+      result.flags = 1;
+      break;
+   case 'A':
+   case 'a':
+      result.flags = 1;
+      break;
+   case 'r':
+   case 'i':
+      result = known;
+      result.flags = 0;
+      if (known.cell == imm) result.cell = -1;
+      break;
+   case 'T':
+   case 't':
+   case 'o':
+      result = known;
+      result.flags = 0;
+      break;
+    }
+
+   return result;
+ }
+
+   // Whether knowing have is enough to run code that was compiled knowing need.
+int enough(struct fact have, struct fact need)
+ {
+   return ((-1 == need.cell) || (have.cell == need.cell)) &&
+      ((-1 == need.constant) || (have.constant == need.constant)) &&
+      (!need.flags || have.flags);
+ }
+
+   // Pick the cells to keep in registers: of the low cells, the ones named by the most instructions,
+   // if more than one.
+void chooseCached(struct jit * jit, const unsigned char * roi, const unsigned char * rod)
+ {
+   int uses [MEM];
+   int pc, i, best;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      uses[pc] = 0;
+      jit->reg[pc] = -1;
+    }
+   for (pc = 0; pc < MEM - 1; ++pc)
+    {
+      if ((rod[pc] < CACHE_LIMIT) && (0 != roi[pc]) && (NULL != strchr("GOAgorbitsa", roi[pc]))) ++uses[rod[pc]];
+    }
+
+   jit->cacheEnd = 0;
+   for (jit->numCached = 0; jit->numCached < MAX_CACHED; ++jit->numCached)
+    {
+      best = 0;
+      for (i = 1; i < CACHE_LIMIT; ++i)
+       {
+         if (uses[i] > uses[best]) best = i;
+       }
+      if (uses[best] < 2) break;
+      uses[best] = 0;
+      jit->cells[jit->numCached] = best;
+      jit->reg[best] = R12 + jit->numCached;
+      if (best >= jit->cacheEnd) jit->cacheEnd = best + 1;
+    }
+ }
+
+void compile(struct jit * jit, const unsigned char * roi, const unsigned char * rod)
+ {
+   static const struct fact nothing = { -1, -1, 0 };
+   struct fact before [MEM];
+   struct fact known;
+   struct guard * guard;
+   int pc, i, length, numFixups, numGuards, target, rel;
+
+   jit->size = 0;
+   jit->numFixups = 0;
+   jit->numGuards = 0;
+   chooseCached(jit, roi, rod);
+
+      // Prologue: push %rbp; push %rbx; push %r12-%r15; push the context (which leaves the stack
+      // aligned for calls); lea 128(%rdi), %rbp; xor %ebx, %ebx; then load the cache.
+   emit1(jit, 0x55); emit1(jit, 0x53);
+   emit1(jit, 0x41); emit1(jit, 0x54); emit1(jit, 0x41); emit1(jit, 0x55);
+   emit1(jit, 0x41); emit1(jit, 0x56); emit1(jit, 0x41); emit1(jit, 0x57);
+   emit1(jit, 0x56);
+   emit1(jit, 0x48); emit1(jit, 0x8D); emit1(jit, 0xAF); emit4(jit, 128);
+   emit1(jit, 0x31); emit1(jit, 0xDB);
+   emitReload(jit);
+
+   known = nothing;
+   for (pc = 0; pc < MEM - 1; ++pc)
+    {
+      jit->main[pc] = jit->size;
+      before[pc] = known;
+      translate(jit, pc, roi[pc], rod[pc], known);
+      known = learn(roi[pc], rod[pc], known);
+    }
+
+      // Execution stops when it gets to the end of memory. Write back the cache, then
+      // the epilogue: pop the context; pop %r15-%r12; pop %rbx; pop %rbp; ret
+   jit->main[MEM - 1] = jit->size;
+   before[MEM - 1] = nothing;
+   emitWriteBack(jit);
+   emit1(jit, 0x5E);
+   emit1(jit, 0x41); emit1(jit, 0x5F); emit1(jit, 0x41); emit1(jit, 0x5E);
+   emit1(jit, 0x41); emit1(jit, 0x5D); emit1(jit, 0x41); emit1(jit, 0x5C);
+   emit1(jit, 0x5B); emit1(jit, 0x5D); emit1(jit, 0xC3);
+
+      // The entries, for when we get to an instruction by a branch. If the entry gets long, it
+      // gives up and goes to the next instruction's entry instead, which knows nothing either.
+      // If it turns out to be the same as the main line, it isn't needed: the instruction didn't
+      // use what it knew (for instance, a Gx after S0 Bn), and the main line can be the entry.
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      jit->entry[pc] = jit->main[pc];
+      if (!enough(nothing, before[pc]))
+       {
+         jit->entry[pc] = jit->size;
+         numFixups = jit->numFixups;
+         numGuards = jit->numGuards;
+         known = nothing;
+         length = 0;
+         i = pc;
+         do
+          {
+            translate(jit, i, roi[i], rod[i], known);
+            known = learn(roi[i], rod[i], known);
+            ++i;
+            ++length;
+          }
+         while (!enough(known, before[i]) && (length < MAX_ENTRY));
+         if ((1 == length) && enough(known, before[i]) &&
+            (jit->size - jit->entry[pc] == jit->main[i] - jit->main[pc]) &&
+            (0 == memcmp(jit->code + jit->entry[pc], jit->code + jit->main[pc], jit->size - jit->entry[pc])))
+          {
+            jit->size = jit->entry[pc];
+            jit->numFixups = numFixups;
+            jit->numGuards = numGuards;
+            jit->entry[pc] = jit->main[pc];
+          }
+         else
+          {
+            emitJump(jit, enough(known, before[i]) ? (TARGET_MAIN + i) : i);
+          }
+       }
+    }
+
+      // The indirect accesses that hit the cache.
+   for (i = 0; i < jit->numGuards; ++i)
+    {
+      guard = jit->guards + i;
+      rel = jit->size - (guard->pos + 4);
+      memcpy(jit->code + guard->pos, &rel, 4);
+      emitWriteBack(jit);
+      if (guard->store)
+       {
+         emitOp(jit, 0, 0x88, RBX, INDEXED, guard->address);                 // mov %bl, MEM(%address)
+         emitReload(jit);
+       }
+      emit1(jit, 0xE9);
+      emit4(jit, guard->resume - (jit->size + 4));
+    }
+
+   while (0 != (jit->size & 3))
+    {
+      emit1(jit, 0xCC);
+    }
+   jit->table = jit->size;
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      emit4(jit, jit->entry[pc] - jit->table);
+    }
+
+   for (i = 0; i < jit->numFixups; ++i)
+    {
+      target = jit->fixups[i].target;
+      if (TARGET_TABLE == target) target = jit->table;
+      else if (target >= TARGET_MAIN) target = jit->main[target - TARGET_MAIN];
+      else target = jit->entry[target];
+      rel = target - (jit->fixups[i].pos + 4);
+      memcpy(jit->code + jit->fixups[i].pos, &rel, 4);
+    }
+ }
+
+#endif /* GORBIT_JIT_H */
@@ -0,0 +1,221 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   The jobs of GORBIT-ROM-BATCH and GORBIT-ROM-SIMD, which run one program against many inputs.
+
+   A job is one run of the program: its input, all of it in memory, and its output, which grows as
+   the program prints. Either a job is an input file, whose output goes to input_file.out, or it is a
+   line of one (a record), whose output the engine prints. The engine runs the program with jobGet
+   and jobPut in place of ioGet and ioPut, and jobIllegal for the illegal instruction message, which
+   ends the job. Nothing here is shared between jobs, so workers on different jobs don't need a lock.
+*/
+
+#ifndef GORBIT_JOB_H
+#define GORBIT_JOB_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_MESSAGE 128
+
+   // A job's status, which is also the engine's exit status: the worst of them.
+#define JOB_OK      0
+#define JOB_ILLEGAL 1
+#define JOB_IO      3
+
+struct job
+ {
+   const char * name;            // The input file, or NULL for a record.
+   unsigned char * input;
+   size_t inputSize;
+   size_t inputPos;
+   unsigned char * output;
+   size_t outputSize;
+   size_t outputCapacity;
+   int status;
+ };
+
+static inline int jobGet (struct job * job)
+ {
+   if (job->inputPos == job->inputSize)
+    {
+      return EOF;
+    }
+   return job->input[job->inputPos++];
+ }
+
+static void jobPut (struct job * job, int c)
+ {
+   if (job->outputSize == job->outputCapacity)
+    {
+      job->outputCapacity = (0 == job->outputCapacity) ? 256 : (job->outputCapacity * 2);
+      job->output = realloc(job->output, job->outputCapacity);
+      if (NULL == job->output)
+       {
+         printf("out of memory\n");
+         exit(5);
+       }
+    }
+   job->output[job->outputSize++] = c;
+ }
+
+   // The message is as long as snprintf says, not up to the first NUL: an opcode of 0 is one.
+static void jobIllegal (struct job * job, int pc, int acc, int op, int imm)
+ {
+   char message [MAX_MESSAGE];
+   int length, i;
+
+   length = snprintf(message, sizeof(message), "Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, op, imm);
+   if (length > (int) sizeof(message) - 1) length = sizeof(message) - 1;
+   for (i = 0; i < length; ++i)
+    {
+      jobPut(job, message[i]);
+    }
+   job->status = JOB_ILLEGAL;
+ }
+
+   // Read a whole file. Returns NULL if it can't.
+static unsigned char * jobReadFile (const char * name, size_t * size)
+ {
+   FILE * file;
+   unsigned char * buffer, * grown;
+   size_t capacity, got;
+
+   file = fopen(name, "rb");
+   if (NULL == file)
+    {
+      return NULL;
+    }
+
+   capacity = 4096;
+   *size = 0;
+   buffer = malloc(capacity);
+   while (NULL != buffer)
+    {
+      got = fread(buffer + *size, 1, capacity - *size, file);
+      *size += got;
+      if (*size < capacity)
+       {
+         break;
+       }
+      capacity *= 2;
+      grown = realloc(buffer, capacity);
+      if (NULL == grown)
+       {
+         free(buffer);
+       }
+      buffer = grown;
+    }
+
+   if ((NULL != buffer) && ferror(file))
+    {
+      free(buffer);
+      buffer = NULL;
+    }
+   fclose(file);
+   return buffer;
+ }
+
+   // Split every input file into its lines, and make each one a job. The jobs point into the
+   // files' buffers, which are kept until the end. A file that can't be read makes status JOB_IO.
+static struct job * jobReadRecords (char ** names, int numNames, int * numJobs, int * status)
+ {
+   struct job * jobs;
+   unsigned char * buffer;
+   size_t size, start, end;
+   int i, capacity;
+
+   jobs = NULL;
+   capacity = 0;
+   *numJobs = 0;
+   for (i = 0; i < numNames; ++i)
+    {
+      buffer = jobReadFile(names[i], &size);
+      if (NULL == buffer)
+       {
+         fprintf(stderr, "cannot open input file %s\n", names[i]);
+         *status = JOB_IO;
+         continue;
+       }
+
+      for (start = 0; start < size; start = end + 1)
+       {
+         for (end = start; (end < size) && ('\n' != buffer[end]); ++end) ;
+
+         if (*numJobs == capacity)
+          {
+            capacity = (0 == capacity) ? 1024 : (capacity * 2);
+            jobs = realloc(jobs, capacity * sizeof(struct job));
+            if (NULL == jobs)
+             {
+               printf("out of memory\n");
+               exit(5);
+             }
+          }
+         memset(&jobs[*numJobs], 0, sizeof(struct job));
+         jobs[*numJobs].input = buffer + start;
+         jobs[*numJobs].inputSize = end - start;
+         ++*numJobs;
+       }
+    }
+
+   return jobs;
+ }
+
+   // Write a file's job's output to input_file.out. If it can't, the job's status is JOB_IO.
+static void jobWriteOutput (struct job * job)
+ {
+   char * outName;
+   FILE * outfile;
+
+   outName = malloc(strlen(job->name) + 5);
+   if (NULL == outName)
+    {
+      printf("out of memory\n");
+      exit(5);
+    }
+   strcpy(outName, job->name);
+   strcat(outName, ".out");
+   outfile = fopen(outName, "wb");
+   if ((NULL == outfile) || (job->outputSize != fwrite(job->output, 1, job->outputSize, outfile)))
+    {
+      fprintf(stderr, "cannot write output file %s\n", outName);
+      job->status = JOB_IO;
+    }
+   if ((NULL != outfile) && (0 != fclose(outfile)))
+    {
+      fprintf(stderr, "cannot write output file %s\n", outName);
+      job->status = JOB_IO;
+    }
+   free(outName);
+ }
+
+#endif /* GORBIT_JOB_H */
@@ -0,0 +1,213 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   An execution profile, for engines built with -DGORBIT_PROFILE.
+
+   GORBIT-ROM-TCO-TR shows everything a program does, one printf at a time, which is too slow for a
+   real run. This only counts: PROFILE_COUNT(pc) is an increment of a counter for the instruction
+   about to run, and PROFILE_TAKEN(pc) an increment of a second counter for a B or b that jumps, so
+   the not taken count is the difference. Both are flat arrays indexed by PC.
+
+   At exit, the instructions that ran are printed to stderr, most executed first, with the share of
+   the total, the branch counts, and where each one is in the program: its line and column, and the
+   text of the line (or of the part of it around the instruction, if it is long). The program file
+   is read again for that, as the engines don't keep it.
+
+   Without -DGORBIT_PROFILE, all of this is nothing.
+
+   An engine includes this after defining MEM, calls profileInit after loading the program, counts
+   every instruction it dispatches with PROFILE_COUNT, and the jumps of B and b with PROFILE_TAKEN.
+*/
+
+#ifndef GORBIT_PROFILE_H
+#define GORBIT_PROFILE_H
+
+#ifdef GORBIT_PROFILE
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PROFILE_COUNT(pc) (++profileCount[pc])
+#define PROFILE_TAKEN(pc) (++profileTaken[pc])
+
+#define PROFILE_LINE 72
+
+static unsigned long long profileCount [MEM];
+static unsigned long long profileTaken [MEM];
+static unsigned char profileRoi [MEM], profileRod [MEM];
+static const char * profileSource;
+
+static int profileCompare (const void * left, const void * right)
+ {
+   unsigned long long l = profileCount[*(const int *) left], r = profileCount[*(const int *) right];
+
+   if (l != r) return (l < r) ? 1 : -1;
+   return *(const int *) left - *(const int *) right;
+ }
+
+   // Find where every instruction is in the source, the way loadToMem reads it. Line and column
+   // count from 1, and start[pc] is where that line starts in text.
+static char * profileLocate (int * line, int * column, long * start)
+ {
+   FILE * source;
+   char * text;
+   long size, pos, lineStart;
+   int cur, lineNumber;
+
+   source = fopen(profileSource, "r");
+   if (NULL == source)
+    {
+      return NULL;
+    }
+   fseek(source, 0, SEEK_END);
+   size = ftell(source);
+   rewind(source);
+   text = (size < 0) ? NULL : malloc(size + 1);
+   if ((NULL == text) || ((size_t) size != fread(text, 1, size, source)))
+    {
+      free(text);
+      fclose(source);
+      return NULL;
+    }
+   text[size] = '\0';
+   fclose(source);
+
+   pos = 0;
+   lineStart = 0;
+   lineNumber = 1;
+   for (cur = 0; (cur < MEM) && (pos < size); ++cur)
+    {
+      line[cur] = lineNumber;
+      column[cur] = pos - lineStart + 1;
+      start[cur] = lineStart;
+
+      ++pos;
+      while ((pos < size) && (text[pos] >= '0') && (text[pos] <= '9'))
+       {
+         ++pos;
+       }
+      while ((pos < size) && ((' ' == text[pos]) || ('\t' == text[pos]) || ('\n' == text[pos]) || ('\r' == text[pos])))
+       {
+         if ('\n' == text[pos])
+          {
+            ++lineNumber;
+            lineStart = pos + 1;
+          }
+         ++pos;
+       }
+    }
+   for (; cur < MEM; ++cur)
+    {
+      line[cur] = 0;
+    }
+
+   return text;
+ }
+
+static void profileReport (void)
+ {
+   int order [MEM], line [MEM], column [MEM];
+   long start [MEM];
+   unsigned long long total;
+   char * text;
+   int pc, i, length, from;
+
+   total = 0;
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      order[pc] = pc;
+      if ('D' != profileRoi[pc]) total += profileCount[pc];
+    }
+   qsort(order, MEM, sizeof(int), profileCompare);
+   text = profileLocate(line, column, start);
+
+   fprintf(stderr, "\nProfile of %s: %llu instructions\n", profileSource, total);
+   fprintf(stderr, "      count      %%    pc  instr          taken      not taken  line:col\n");
+   for (i = 0; (i < MEM) && (0 != profileCount[order[i]]); ++i)
+    {
+      pc = order[i];
+      if ('D' == profileRoi[pc])
+       {
+         continue; // The end of the program, which isn't an instruction.
+       }
+
+      fprintf(stderr, "%11llu %6.2f%%  %3d  %c%-3d  ", profileCount[pc], 100.0 * profileCount[pc] / total, pc, profileRoi[pc], profileRod[pc]);
+      if (('B' == profileRoi[pc]) || ('b' == profileRoi[pc]))
+       {
+         fprintf(stderr, "%13llu  %13llu  ", profileTaken[pc], profileCount[pc] - profileTaken[pc]);
+       }
+      else
+       {
+         fprintf(stderr, "%13s  %13s  ", "", "");
+       }
+
+      if ((NULL != text) && (0 != line[pc]))
+       {
+         for (length = 0; ('\0' != text[start[pc] + length]) && ('\n' != text[start[pc] + length]) && ('\r' != text[start[pc] + length]); ++length) ;
+         from = 0;
+         if (length > PROFILE_LINE)
+          {
+            from = column[pc] - 1 - PROFILE_LINE / 3;
+            if (from > length - PROFILE_LINE) from = length - PROFILE_LINE;
+            if (from < 0) from = 0;
+          }
+         fprintf(stderr, "%d:%d  %s%.*s%s", line[pc], column[pc], (from > 0) ? "..." : "",
+            (length - from > PROFILE_LINE) ? PROFILE_LINE : (length - from), text + start[pc] + from,
+            (length - from > PROFILE_LINE) ? "..." : "");
+       }
+      fprintf(stderr, "\n");
+    }
+
+   free(text);
+ }
+
+   // Call once the program is loaded. The report is printed at exit.
+static void profileInit (const char * source, const unsigned char * roi, const unsigned char * rod)
+ {
+   int pc;
+
+   profileSource = source;
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      profileRoi[pc] = roi[pc];
+      profileRod[pc] = rod[pc];
+    }
+   atexit(profileReport);
+ }
+
+#else
+
+#define PROFILE_COUNT(pc)
+#define PROFILE_TAKEN(pc)
+#define profileInit(source, roi, rod)
+
+#endif
+
+#endif /* GORBIT_PROFILE_H */
@@ -0,0 +1,469 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   GORBIT-RAM-TCO, direct threaded.
+
+   In RAM, the program is data like any other, and can be rewritten as it runs, so the RAM engines look
+   up operations[rwd[pc]] for every instruction they execute. But few programs ever write to their own
+   opcodes. This engine keeps a handler for every cell of memory, in code, decoded from it once, and
+   dispatches through that, the way GORBIT-ROM-DT does. Every store to a cell also sets its handler
+   to Z, which decodes the cell again when (if) it's executed, and then runs it. A program that only
+   writes to data pays for one more store per store; a program that rewrites itself, for decoding
+   each instruction it rewrote one more time.
+
+   Every cell gets a handler, not just the even ones: a branch can go to an odd address. Z is also what
+   stops the program at 255, so a store there doesn't make it executable, and DISPATCH doesn't have to
+   check for the end of memory. Past that, instruction 254 goes to 256, which is always D.
+
+   Most programs don't need even that. O, r, and i store to the address in their immediate, which is
+   known before the program runs, so, after loading, prove() follows every path from 0, the way it
+   would go if the code never changed, and marks as watched every cell that gets executed, and every
+   immediate that decides where a B goes or where an O, r, or i stores. If none of those stores lands
+   on a watched cell, the code can only change through o. The program then runs with proven[]: the
+   same handlers, but O, r, and i just store, and o checks whether its store lands on a watched cell.
+   If one ever does, every handler is decoded again from operations[], and the rest of the program
+   runs checked, as above. A program that can get to a b could go anywhere, so it always runs checked.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "GORBIT-IO.h"
+#include "GORBIT-TAIL.h"
+
+/*
+G     ACC = MEM[IMM]
+O     MEM[IMM] = ACC
+R     ACC = INPUT
+B     BRZ IMM
+I     ACC += IMM
+T     PRINT ACC
+S     ACC = IMM
+A     ACC += MEM[IMM]
+
+g     ACC = MEM[MEM[IMM]]
+o     MEM[MEM[IMM]] = ACC
+r     MEM[IMM] = INPUT
+b     BRZ MEM[IMM]
+i     MEM[IMM] += ACC
+t     PRINT MEM[IMM]
+s     ACC ^= MEM[IMM]
+a     ACC += MEM[MEM[IMM]]
+
+Translation:
+   ACC      acc
+   IMM      rwd[pc + 1]
+   MEM      rwd
+*/
+
+#define MEM 256
+
+#define DISPATCH \
+   pc += 2; \
+   TAIL_CALL code[pc].handler(code, rwd, pc, acc);
+
+   // A store to MEM[address]: the cell has to be decoded again before it's executed. This marks it
+   // first, as the store can change what address is.
+#define STORE(address, value) \
+   code[address].handler = Z; \
+   rwd[address] = value
+
+struct slot;
+
+typedef void (TAIL_CC * handler)(struct slot * code, unsigned char * rwd, int pc, unsigned char acc);
+
+struct slot
+ {
+   handler handler;
+ };
+
+extern handler operations[], proven[];
+
+static unsigned char watched [MEM];  // The cells a proven program's o has to check for.
+
+void translate(struct slot * code, const unsigned char * rwd, const handler * table);
+
+TAIL_HANDLER void Z (struct slot * code, unsigned char * rwd, int pc, unsigned char acc);
+
+TAIL_HANDLER void G (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   acc = rwd[rwd[pc + 1]];
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void O (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   STORE(rwd[pc + 1], acc);
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void R (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   acc = ioGet();
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void B (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   if (0 == acc) pc = rwd[pc + 1] - 2;
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void I (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   acc += rwd[pc + 1];
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void T (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   ioPut(acc);
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void S (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   acc = rwd[pc + 1];
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void A (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   acc += rwd[rwd[pc + 1]];
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void g (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   acc = rwd[rwd[rwd[pc + 1]]];
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void o (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   STORE(rwd[rwd[pc + 1]], acc);
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void r (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   STORE(rwd[pc + 1], ioGet());
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void b (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   if (0 == acc) pc = rwd[rwd[pc + 1]] - 2;
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void i (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   STORE(rwd[pc + 1], rwd[rwd[pc + 1]] + acc);
+
+   DISPATCH
+ }
+
+   // The stores, for a proven program.
+TAIL_HANDLER void PO (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   rwd[rwd[pc + 1]] = acc;
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void Po (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   if (watched[rwd[rwd[pc + 1]]])
+    {
+      translate(code, rwd, operations); // It's rewriting itself: check everything from here on.
+      TAIL_CALL o(code, rwd, pc, acc);
+    }
+   rwd[rwd[rwd[pc + 1]]] = acc;
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void Pr (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   rwd[rwd[pc + 1]] = ioGet();
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void Pi (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   rwd[rwd[pc + 1]] += acc;
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void t (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   ioPut(rwd[rwd[pc + 1]]);
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void s (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   acc ^= rwd[rwd[pc + 1]];
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void a (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   acc += rwd[rwd[rwd[pc + 1]]];
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void E (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   (void) code;
+   ioFlush();
+   printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, rwd[pc], rwd[pc + 1]);
+   exit(1);
+ }
+
+TAIL_HANDLER void D(struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   (void) code; (void) rwd; (void) pc; (void) acc;
+   return;
+ }
+
+TAIL_HANDLER void Z (struct slot * code, unsigned char * rwd, int pc, unsigned char acc)
+ {
+   if (pc >= (MEM - 1)) return;
+   code[pc].handler = operations[rwd[pc]];
+
+   TAIL_CALL code[pc].handler(code, rwd, pc, acc);
+ }
+
+handler operations[] =
+ {
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, A, B, E, D, E, E, G, E, I, E, E, E, E, E, O,
+   E, E, R, S, T, E, E, E, E, E, E, E, E, E, E, E,
+   E, a, b, E, E, E, E, g, E, i, E, E, E, E, E, o,
+   E, E, r, s, t, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E
+ };
+
+handler proven[] =
+ {
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, A, B, E, D, E, E, G, E, I, E, E, E, E, E, PO,
+   E, E, R, S, T, E, E, E, E, E, E, E, E, E, E, E,
+   E, a, b, E, E, E, E, g, E, Pi, E, E, E, E, E, Po,
+   E, E, Pr, s, t, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E
+ };
+
+void loadToMem(unsigned char * rwd, FILE* source)
+ {
+   int input, cur;
+
+   input = fgetc(source);
+   cur = 0;
+
+   while (EOF != input)
+    {
+      rwd[cur] = input;
+      rwd[cur + 1] = 0;
+
+      input = fgetc(source);
+
+      while ((input >= '0') && (input <= '9'))
+       {
+         rwd[cur + 1] = rwd[cur + 1] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+
+//printf("loaded instruction %c%d\n", rwd[cur], rwd[cur + 1]);
+      cur += 2;
+      if (MEM == cur)
+       {
+         printf("error, program too big\n");
+         exit(4);
+       }
+    }
+
+   if (MEM != cur)
+    {
+      rwd[cur] = 'D'; // Pseudo-instruction "done"
+    }
+ }
+
+   // Can the program's code only change through o? Marks what o has to watch for, if so.
+int prove(const unsigned char * rwd)
+ {
+   unsigned char reached [MEM], stack [MEM];
+   int top, pc, next;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      reached[pc] = 0;
+      watched[pc] = 0;
+    }
+
+   top = 0;
+   stack[top++] = 0;
+   reached[0] = 1;
+   while (0 != top)
+    {
+      pc = stack[--top];
+      watched[pc] = 1;
+      switch (rwd[pc])
+       {
+      case 'b':
+         return 0;
+      case 'D':
+         continue;
+      case 'B':
+         watched[pc + 1] = 1;
+         next = rwd[pc + 1];
+         if ((next < MEM - 1) && !reached[next])
+          {
+            reached[next] = 1;
+            stack[top++] = next;
+          }
+         break;
+      case 'O':
+      case 'r':
+      case 'i':
+         watched[pc + 1] = 1;
+         break;
+      case 'G': case 'R': case 'I': case 'T': case 'S': case 'A':
+      case 'g': case 'o': case 't': case 's': case 'a':
+         break;
+      default:
+         continue; // Illegal: the program stops there.
+       }
+
+      next = pc + 2;
+      if ((next < MEM - 1) && !reached[next])
+       {
+         reached[next] = 1;
+         stack[top++] = next;
+       }
+    }
+
+   for (pc = 0; pc < MEM - 1; ++pc)
+    {
+      if (reached[pc] && (('O' == rwd[pc]) || ('r' == rwd[pc]) || ('i' == rwd[pc])) && watched[rwd[pc + 1]])
+       {
+         return 0;
+       }
+    }
+   return 1;
+ }
+
+void translate(struct slot * code, const unsigned char * rwd, const handler * table)
+ {
+   int pc;
+
+   for (pc = 0; pc < MEM - 1; ++pc)
+    {
+      code[pc].handler = table[rwd[pc]];
+    }
+   code[MEM - 1].handler = Z;
+   code[MEM].handler = D;
+ }
+
+int main (int argc, char ** argv)
+ {
+   unsigned char rwd[MEM];
+   struct slot code [MEM + 1];
+   int pc;
+   FILE * infile;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      rwd[pc] = 0;
+    }
+
+   if (2 != argc)
+    {
+      printf("usage: GORBIT-ROM source_file\n");
+      return 2;
+    }
+   infile = fopen(argv[1], "r");
+   if (NULL == infile)
+    {
+      printf("cannot open input file\n");
+      return 3;
+    }
+   loadToMem(rwd, infile);
+   fclose(infile);
+   ioInit();
+   translate(code, rwd, prove(rwd) ? proven : operations);
+
+   code[0].handler(code, rwd, 0, 0);
+
+   return 0;
+ }
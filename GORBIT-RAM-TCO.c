@@ -70,6 +70,8 @@ SUCH DAMAGE.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "GORBIT-IO.h"
+#include "GORBIT-TAIL.h"
 
 /*
 G     ACC = MEM[IMM]
@@ -101,135 +103,136 @@ Translation:
 #define DISPATCH \
    pc += 2; \
    if (pc >= (MEM - 1)) return; \
-   operations[rwd[pc]](rwd, pc, acc);
+   TAIL_CALL operations[rwd[pc]](rwd, pc, acc);
 
-extern void (*operations[])(unsigned char * rwd, int pc, unsigned char acc);
+extern void (TAIL_CC * operations[])(unsigned char * rwd, int pc, unsigned char acc);
 
-void G (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void G (unsigned char * rwd, int pc, unsigned char acc)
  {
    acc = rwd[rwd[pc + 1]];
 
    DISPATCH
  }
 
-void O (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void O (unsigned char * rwd, int pc, unsigned char acc)
  {
    rwd[rwd[pc + 1]] = acc;
 
    DISPATCH
  }
 
-void R (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void R (unsigned char * rwd, int pc, unsigned char acc)
  {
-   acc = getchar();
+   acc = ioGet();
 
    DISPATCH
  }
 
-void B (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void B (unsigned char * rwd, int pc, unsigned char acc)
  {
    if (0 == acc) pc = rwd[pc + 1] - 2;
 
    DISPATCH
  }
 
-void I (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void I (unsigned char * rwd, int pc, unsigned char acc)
  {
    acc += rwd[pc + 1];
 
    DISPATCH
  }
 
-void T (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void T (unsigned char * rwd, int pc, unsigned char acc)
  {
-   putchar(acc);
+   ioPut(acc);
 
    DISPATCH
  }
 
-void S (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void S (unsigned char * rwd, int pc, unsigned char acc)
  {
    acc = rwd[pc + 1];
 
    DISPATCH
  }
 
-void A (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void A (unsigned char * rwd, int pc, unsigned char acc)
  {
    acc += rwd[rwd[pc + 1]];
 
    DISPATCH
  }
 
-void g (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void g (unsigned char * rwd, int pc, unsigned char acc)
  {
    acc = rwd[rwd[rwd[pc + 1]]];
 
    DISPATCH
  }
 
-void o (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void o (unsigned char * rwd, int pc, unsigned char acc)
  {
    rwd[rwd[rwd[pc + 1]]] = acc;
 
    DISPATCH
  }
 
-void r (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void r (unsigned char * rwd, int pc, unsigned char acc)
  {
-   rwd[rwd[pc + 1]] = getchar();
+   rwd[rwd[pc + 1]] = ioGet();
 
    DISPATCH
  }
 
-void b (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void b (unsigned char * rwd, int pc, unsigned char acc)
  {
    if (0 == acc) pc = rwd[rwd[pc + 1]] - 2;
 
    DISPATCH
  }
 
-void i (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void i (unsigned char * rwd, int pc, unsigned char acc)
  {
    rwd[rwd[pc + 1]] += acc;
 
    DISPATCH
  }
 
-void t (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void t (unsigned char * rwd, int pc, unsigned char acc)
  {
-   putchar(rwd[rwd[pc + 1]]);
+   ioPut(rwd[rwd[pc + 1]]);
 
    DISPATCH
  }
 
-void s (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void s (unsigned char * rwd, int pc, unsigned char acc)
  {
    acc ^= rwd[rwd[pc + 1]];
 
    DISPATCH
  }
 
-void a (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void a (unsigned char * rwd, int pc, unsigned char acc)
  {
    acc += rwd[rwd[rwd[pc + 1]]];
 
    DISPATCH
  }
 
-void E (unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void E (unsigned char * rwd, int pc, unsigned char acc)
  {
+   ioFlush();
    printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, rwd[pc], rwd[pc + 1]);
    exit(1);
  }
 
-void D(unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void D(unsigned char * rwd, int pc, unsigned char acc)
  {
    (void) rwd; (void) pc; (void) acc;
    return;
  }
 
-void (*operations[])(unsigned char * rwd, int pc, unsigned char acc) =
+void (TAIL_CC * operations[])(unsigned char * rwd, int pc, unsigned char acc) =
  {
    E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
    E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
@@ -313,6 +316,7 @@ int main (int argc, char ** argv)
     }
    loadToMem(rwd, infile);
    fclose(infile);
+   ioInit();
 
    operations[rwd[0]](rwd, 0, 0);
 
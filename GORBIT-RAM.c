@@ -71,6 +71,7 @@ SUCH DAMAGE.
 #include <stdio.h>
 #include <stdlib.h>
 #include <setjmp.h>
+#include "GORBIT-IO.h"
 
 /*
 G     ACC = MEM[IMM]
@@ -123,7 +124,7 @@ void O (unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int ge
 
 void R (unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int gen)
  {
-   *acc = getchar();
+   *acc = ioGet();
 
    DISPATCH
  }
@@ -144,7 +145,7 @@ void I (unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int ge
 
 void T (unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int gen)
  {
-   putchar(*acc);
+   ioPut(*acc);
 
    DISPATCH
  }
@@ -179,7 +180,7 @@ void o (unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int ge
 
 void r (unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int gen)
  {
-   rwd[rwd[*pc + 1]] = getchar();
+   rwd[rwd[*pc + 1]] = ioGet();
 
    DISPATCH
  }
@@ -200,7 +201,7 @@ void i (unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int ge
 
 void t (unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int gen)
  {
-   putchar(rwd[rwd[*pc + 1]]);
+   ioPut(rwd[rwd[*pc + 1]]);
 
    DISPATCH
  }
@@ -222,6 +223,7 @@ void a (unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int ge
 void E (unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int gen)
  {
    (void) cont; (void) gen;
+   ioFlush();
    printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", *pc, *acc, rwd[*pc], rwd[*pc + 1]);
    exit(1);
  }
@@ -317,6 +319,7 @@ int main (int argc, char ** argv)
     }
    loadToMem(rwd, infile);
    fclose(infile);
+   ioInit();
 
    acc = 0;
    pc = 0;
@@ -35,6 +35,7 @@ SUCH DAMAGE.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "GORBIT-IO.h"
 
 /*
 G     ACC = MEM[IMM]
@@ -65,7 +66,6 @@ Translation:
 
 #define DISPATCH \
    ++*pc; \
-   if (*pc == (MEM - 1)) return 0; \
    if (1024 == gen) return 1; \
    return operations[roi[*pc]](roi, rod, rwd, pc, acc, gen + 1);
 
@@ -87,7 +87,7 @@ int O (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc,
 
 int R (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc, unsigned char * acc, int gen)
  {
-   *acc = getchar();
+   *acc = ioGet();
 
    DISPATCH
  }
@@ -108,7 +108,7 @@ int I (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc,
 
 int T (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc, unsigned char * acc, int gen)
  {
-   putchar(*acc);
+   ioPut(*acc);
 
    DISPATCH
  }
@@ -143,7 +143,7 @@ int o (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc,
 
 int r (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc, unsigned char * acc, int gen)
  {
-   rwd[rod[*pc]] = getchar();
+   rwd[rod[*pc]] = ioGet();
 
    DISPATCH
  }
@@ -164,7 +164,7 @@ int i (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc,
 
 int t (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc, unsigned char * acc, int gen)
  {
-   putchar(rwd[rod[*pc]]);
+   ioPut(rwd[rod[*pc]]);
 
    DISPATCH
  }
@@ -186,6 +186,7 @@ int a (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc,
 int E (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc, unsigned char * acc, int gen)
  {
    (void) rwd; (void) gen;
+   ioFlush();
    printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", *pc, *acc, roi[*pc], rod[*pc]);
    exit(1);
  }
@@ -218,7 +219,7 @@ int (*operations[])(unsigned char * roi, unsigned char * rod, unsigned char * rw
 
 void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
  {
-   int input, cur;
+   int input, cur, pc;
 
    input = fgetc(source);
    cur = 0;
@@ -250,9 +251,12 @@ void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
        }
     }
 
-   if (MEM != cur)
+      // Everything after the program, including instruction 255, is the pseudo-instruction "done", so
+      // DISPATCH doesn't have to check for the end of memory.
+   for (pc = cur; pc < MEM; ++pc)
     {
-      roi[cur] = 'D'; // Pseudo-instruction "done"
+      roi[pc] = 'D';
+      rod[pc] = 0;
     }
  }
 
@@ -280,6 +284,7 @@ int main (int argc, char ** argv)
     }
    loadToMem(roi, rod, infile);
    fclose(infile);
+   ioInit();
 
    acc = 0;
    pc = 0;
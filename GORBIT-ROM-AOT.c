@@ -0,0 +1,223 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   An ahead-of-time translator: GORBITSA-ROM to C.
+
+   It reads a program the way the engines do, and writes a C program to standard output that does
+   what that program does. (Errors go to standard error, so that they never end up in the C.) Every
+   instruction is a labeled statement, so falling through is falling through. B is an if and a goto.
+   b is an if and a switch with a goto for every one of the 256 possible targets, which GCC turns into
+   a jump table of its own. Getting to instruction 255 returns.
+
+   The point is to pay for the C compiler once per program, and in exchange get its register
+   allocation and constant propagation across the whole program. The Makefile builds Bench.txt this
+   way, into build/<flavor>/Bench-AOT, so that it can be benchmarked next to the engines.
+
+   ACC and MEM are unsigned char, so that wrapping and EOF (which becomes 255) behave the way they do
+   in the engines. The generated code has no labels that nothing jumps to, so it compiles cleanly
+   with -Wall. It stands alone, so rather than GORBIT-IO.h, it uses getchar_unlocked and
+   putchar_unlocked: stdio's buffers, without the locking that a single thread doesn't need.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+G     ACC = MEM[IMM]
+O     MEM[IMM] = ACC
+R     ACC = INPUT
+B     BRZ IMM
+I     ACC += IMM
+T     PRINT ACC
+S     ACC = IMM
+A     ACC += MEM[IMM]
+
+g     ACC = MEM[MEM[IMM]]
+o     MEM[MEM[IMM]] = ACC
+r     MEM[IMM] = INPUT
+b     BRZ MEM[IMM]
+i     MEM[IMM] += ACC
+t     PRINT MEM[IMM]
+s     ACC ^= MEM[IMM]
+a     ACC += MEM[MEM[IMM]]
+*/
+
+#define MEM 256
+
+   // Which instructions something branches to, and so need a label.
+void findTargets(int * target, const unsigned char * roi, const unsigned char * rod)
+ {
+   int pc, anyB;
+
+   anyB = 0;
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      target[pc] = 0;
+    }
+   for (pc = 0; pc < MEM - 1; ++pc)
+    {
+      if ('B' == roi[pc]) target[rod[pc]] = 1;
+      if ('b' == roi[pc]) anyB = 1;
+    }
+   target[MEM - 1] = 1;
+
+      // A b can go anywhere.
+   if (anyB)
+    {
+      for (pc = 0; pc < MEM; ++pc)
+       {
+         target[pc] = 1;
+       }
+    }
+ }
+
+void translate(FILE * out, int pc, unsigned char op, unsigned char imm)
+ {
+   int i;
+
+   switch (op)
+    {
+   case 'G': fprintf(out, "acc = rwd[%d];", imm); break;
+   case 'O': fprintf(out, "rwd[%d] = acc;", imm); break;
+   case 'R': fprintf(out, "acc = getchar_unlocked();"); break;
+   case 'B': fprintf(out, "if (0 == acc) goto L%d;", imm); break;
+   case 'I': fprintf(out, "acc += %d;", imm); break;
+   case 'T': fprintf(out, "putchar_unlocked(acc);"); break;
+   case 'S': fprintf(out, "acc = %d;", imm); break;
+   case 'A': fprintf(out, "acc += rwd[%d];", imm); break;
+   case 'g': fprintf(out, "acc = rwd[rwd[%d]];", imm); break;
+   case 'o': fprintf(out, "rwd[rwd[%d]] = acc;", imm); break;
+   case 'r': fprintf(out, "rwd[%d] = getchar_unlocked();", imm); break;
+   case 'i': fprintf(out, "rwd[%d] += acc;", imm); break;
+   case 't': fprintf(out, "putchar_unlocked(rwd[%d]);", imm); break;
+   case 's': fprintf(out, "acc ^= rwd[%d];", imm); break;
+   case 'a': fprintf(out, "acc += rwd[rwd[%d]];", imm); break;
+   case 'b':
+      fprintf(out, "if (0 == acc) switch (rwd[%d])\n       {", imm);
+      for (i = 0; i < MEM; ++i)
+       {
+         if (0 == (i & 3)) fprintf(out, "\n      ");
+         fprintf(out, " case %d: goto L%d;", i, i);
+       }
+      fprintf(out, "\n       }");
+      break;
+   case 'D': fprintf(out, "goto L%d;", MEM - 1); break;
+   default:
+      fprintf(out, "printf(\"Attempt to execute illegal instruction at program counter %%d. Accumulator: %%d. Instruction: %%c%%d\", %d, acc, %d, %d); exit(1);", pc, op, imm);
+      break;
+    }
+ }
+
+void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
+ {
+   int input, cur, pc;
+
+   input = fgetc(source);
+   cur = 0;
+
+   while (EOF != input)
+    {
+      roi[cur] = input;
+      rod[cur] = 0;
+
+      input = fgetc(source);
+
+      while ((input >= '0') && (input <= '9'))
+       {
+         rod[cur] = rod[cur] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+
+//printf("loaded instruction %c%d\n", roi[cur], rod[cur]);
+      ++cur;
+      if (MEM == cur)
+       {
+         fprintf(stderr, "error, program too big\n");
+         exit(4);
+       }
+    }
+
+   for (pc = cur; pc < MEM; ++pc)
+    {
+      roi[pc] = 'D'; // Pseudo-instruction "done"
+      rod[pc] = 0;
+    }
+ }
+
+int main (int argc, char ** argv)
+ {
+   unsigned char roi [MEM], rod [MEM];
+   int target [MEM];
+   int pc;
+   FILE * infile;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      roi[pc] = 0;
+      rod[pc] = 0;
+    }
+
+   if (2 != argc)
+    {
+      fprintf(stderr, "usage: GORBIT-ROM-AOT source_file\n");
+      return 2;
+    }
+   infile = fopen(argv[1], "r");
+   if (NULL == infile)
+    {
+      fprintf(stderr, "cannot open input file\n");
+      return 3;
+    }
+   loadToMem(roi, rod, infile);
+   fclose(infile);
+
+   findTargets(target, roi, rod);
+
+   printf("/* Translated from %s by GORBIT-ROM-AOT. */\n\n", argv[1]);
+   printf("#include <stdio.h>\n#include <stdlib.h>\n\n");
+   printf("int main (void)\n {\n");
+   printf("   unsigned char rwd [%d] = { 0 };\n", MEM);
+   printf("   unsigned char acc = 0;\n\n");
+   for (pc = 0; pc < MEM - 1; ++pc)
+    {
+      if (target[pc]) printf("L%d:\n", pc);
+      printf("   ");
+      translate(stdout, pc, roi[pc], rod[pc]);
+      printf("\n");
+    }
+   printf("L%d:\n   return 0;\n }\n", MEM - 1);
+
+   return 0;
+ }
@@ -0,0 +1,365 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   Batch mode: load a ROM program once, and run it against many inputs, on every core.
+
+   usage: GORBIT-ROM-BATCH [-j threads] [-r] source_file input_file ...
+
+   Every input file is a job. Its whole contents are the job's standard input, and its standard
+   output goes to input_file.out. With -r, every line of every input file is a job instead, and
+   their outputs are printed to standard output in order, one line each. This is for when the
+   jobs are short: starting a process and loading the program costs more than running it.
+
+   The program (roi and rod) is shared and never written. Each job has its own MEM and ACC, an
+   input buffer, and an output buffer, so the workers share nothing else. Workers take the next
+   job from a counter under a mutex: jobs are few and long compared to taking that lock.
+
+   An illegal instruction ends its job, with the usual message in its output. The exit status
+   is 1 if that happened to any job, and 3 if any input couldn't be read or output written.
+   The interpreter is GORBIT-ROM-SW's switch, with ioGet and ioPut replaced by the job's
+   buffers.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "GORBIT-JOB.h"
+
+/*
+G     ACC = MEM[IMM]
+O     MEM[IMM] = ACC
+R     ACC = INPUT
+B     BRZ IMM
+I     ACC += IMM
+T     PRINT ACC
+S     ACC = IMM
+A     ACC += MEM[IMM]
+
+g     ACC = MEM[MEM[IMM]]
+o     MEM[MEM[IMM]] = ACC
+r     MEM[IMM] = INPUT
+b     BRZ MEM[IMM]
+i     MEM[IMM] += ACC
+t     PRINT MEM[IMM]
+s     ACC ^= MEM[IMM]
+a     ACC += MEM[MEM[IMM]]
+
+Translation:
+   ACC      acc
+   IMM      rod[pc]
+   MEM      rwd
+*/
+
+#define MEM 256
+
+#define MAX_THREADS 256
+
+struct batch
+ {
+   const unsigned char * roi;
+   const unsigned char * rod;
+   struct job * jobs;
+   int numJobs;
+   int next;
+   pthread_mutex_t lock;
+ };
+
+void run(const unsigned char * roi, const unsigned char * rod, struct job * job)
+ {
+   unsigned char rwd [MEM], acc;
+   int pc;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      rwd[pc] = 0;
+    }
+
+   pc = 0;
+   acc = 0;
+
+   while (pc < MEM - 1)
+    {
+      switch (roi[pc])
+       {
+      case 'G':
+         acc = rwd[rod[pc]];
+         break;
+      case 'O':
+         rwd[rod[pc]] = acc;
+         break;
+      case 'R':
+         acc = jobGet(job);
+         break;
+      case 'B':
+         if (0 == acc) pc = rod[pc] - 1;
+         break;
+      case 'I':
+         acc += rod[pc];
+         break;
+      case 'T':
+         jobPut(job, acc);
+         break;
+      case 'S':
+         acc = rod[pc];
+         break;
+      case 'A':
+         acc += rwd[rod[pc]];
+         break;
+      case 'g':
+         acc = rwd[rwd[rod[pc]]];
+         break;
+      case 'o':
+         rwd[rwd[rod[pc]]] = acc;
+         break;
+      case 'r':
+         rwd[rod[pc]] = jobGet(job);
+         break;
+      case 'b':
+         if (0 == acc) pc = rwd[rod[pc]] - 1;
+         break;
+      case 'i':
+         rwd[rod[pc]] += acc;
+         break;
+      case 't':
+         jobPut(job, rwd[rod[pc]]);
+         break;
+      case 's':
+         acc ^= rwd[rod[pc]];
+         break;
+      case 'a':
+         acc += rwd[rwd[rod[pc]]];
+         break;
+      case 'D':
+         pc = MEM;
+         break;
+      default:
+         jobIllegal(job, pc, acc, roi[pc], rod[pc]);
+         pc = MEM;
+         break;
+       }
+
+      ++pc;
+    }
+ }
+
+   // Run a file's job: read it, run it, and write its .out file.
+void runFile(const unsigned char * roi, const unsigned char * rod, struct job * job)
+ {
+   job->input = jobReadFile(job->name, &job->inputSize);
+   if (NULL == job->input)
+    {
+      fprintf(stderr, "cannot open input file %s\n", job->name);
+      job->status = JOB_IO;
+      return;
+    }
+
+   run(roi, rod, job);
+   free(job->input);
+   jobWriteOutput(job);
+   free(job->output);
+   job->output = NULL;
+ }
+
+void * worker(void * arg)
+ {
+   struct batch * batch = arg;
+   struct job * job;
+   int index;
+
+   for (;;)
+    {
+      pthread_mutex_lock(&batch->lock);
+      index = batch->next++;
+      pthread_mutex_unlock(&batch->lock);
+
+      if (index >= batch->numJobs)
+       {
+         return NULL;
+       }
+
+      job = &batch->jobs[index];
+      if (NULL != job->name)
+       {
+         runFile(batch->roi, batch->rod, job);
+       }
+      else
+       {
+         run(batch->roi, batch->rod, job);
+       }
+    }
+ }
+
+void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
+ {
+   int input, cur, pc;
+
+   input = fgetc(source);
+   cur = 0;
+
+   while (EOF != input)
+    {
+      roi[cur] = input;
+      rod[cur] = 0;
+
+      input = fgetc(source);
+
+      while ((input >= '0') && (input <= '9'))
+       {
+         rod[cur] = rod[cur] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+
+//printf("loaded instruction %c%d\n", roi[cur], rod[cur]);
+      ++cur;
+      if (MEM == cur)
+       {
+         printf("error, program too big\n");
+         exit(4);
+       }
+    }
+
+   for (pc = cur; pc < MEM; ++pc)
+    {
+      roi[pc] = 'D'; // Pseudo-instruction "done"
+      rod[pc] = 0;
+    }
+ }
+
+int main (int argc, char ** argv)
+ {
+   unsigned char roi [MEM], rod [MEM];
+   pthread_t threads [MAX_THREADS];
+   struct batch batch;
+   int pc, opt, numThreads, records, status, i;
+   FILE * infile;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      roi[pc] = 0;
+      rod[pc] = 0;
+    }
+
+   numThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+   records = 0;
+   while (-1 != (opt = getopt(argc, argv, "j:r")))
+    {
+      switch (opt)
+       {
+      case 'j':
+         numThreads = atoi(optarg);
+         break;
+      case 'r':
+         records = 1;
+         break;
+      default:
+         printf("usage: GORBIT-ROM-BATCH [-j threads] [-r] source_file input_file ...\n");
+         return 2;
+       }
+    }
+   if (optind >= argc)
+    {
+      printf("usage: GORBIT-ROM-BATCH [-j threads] [-r] source_file input_file ...\n");
+      return 2;
+    }
+   if (numThreads < 1) numThreads = 1;
+   if (numThreads > MAX_THREADS) numThreads = MAX_THREADS;
+
+   infile = fopen(argv[optind], "r");
+   if (NULL == infile)
+    {
+      printf("cannot open input file\n");
+      return 3;
+    }
+   loadToMem(roi, rod, infile);
+   fclose(infile);
+   ++optind;
+
+   status = JOB_OK;
+   batch.roi = roi;
+   batch.rod = rod;
+   batch.next = 0;
+   if (records)
+    {
+      batch.jobs = jobReadRecords(argv + optind, argc - optind, &batch.numJobs, &status);
+    }
+   else
+    {
+      batch.numJobs = argc - optind;
+      batch.jobs = calloc(batch.numJobs + 1, sizeof(struct job));
+      if (NULL == batch.jobs)
+       {
+         printf("out of memory\n");
+         return 5;
+       }
+      for (i = 0; i < batch.numJobs; ++i)
+       {
+         batch.jobs[i].name = argv[optind + i];
+       }
+    }
+   pthread_mutex_init(&batch.lock, NULL);
+
+   if (numThreads > batch.numJobs) numThreads = batch.numJobs;
+   for (i = 0; i < numThreads; ++i)
+    {
+      if (0 != pthread_create(&threads[i], NULL, worker, &batch))
+       {
+         numThreads = i;
+         break;
+       }
+    }
+      // If no thread could be started, do it all here.
+   if ((0 == numThreads) && (batch.numJobs > 0))
+    {
+      worker(&batch);
+    }
+   for (i = 0; i < numThreads; ++i)
+    {
+      pthread_join(threads[i], NULL);
+    }
+
+   for (i = 0; i < batch.numJobs; ++i)
+    {
+      if (records)
+       {
+         fwrite(batch.jobs[i].output, 1, batch.jobs[i].outputSize, stdout);
+         putchar('\n');
+       }
+      if (batch.jobs[i].status > status) status = batch.jobs[i].status;
+    }
+
+   return status;
+ }
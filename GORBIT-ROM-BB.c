@@ -0,0 +1,159 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   GORBIT-ROM-DT, with a compiler in front of it: see GORBIT-BB.h.
+
+   Each block is compiled the first time it is reached: the stub in entry[] compiles it, and the
+   block replaces the stub.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "GORBIT-IO.h"
+#include "GORBIT-TAIL.h"
+
+/*
+G     ACC = MEM[IMM]
+O     MEM[IMM] = ACC
+R     ACC = INPUT
+B     BRZ IMM
+I     ACC += IMM
+T     PRINT ACC
+S     ACC = IMM
+A     ACC += MEM[IMM]
+
+g     ACC = MEM[MEM[IMM]]
+o     MEM[MEM[IMM]] = ACC
+r     MEM[IMM] = INPUT
+b     BRZ MEM[IMM]
+i     MEM[IMM] += ACC
+t     PRINT MEM[IMM]
+s     ACC ^= MEM[IMM]
+a     ACC += MEM[MEM[IMM]]
+
+Translation:
+   ACC      acc, or whatever compile() knows it to be
+   MEM      rwd
+   PC       the pc the block was compiled from, and entry[] to get back in
+*/
+
+#define MEM 256
+
+#include "GORBIT-IMAGE.h"
+#include "GORBIT-BB.h"
+
+   // The first time a block is reached: compile it, and never come back here. K is its pc.
+TAIL_HANDLER void Compile (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   atomic_store_explicit(&entry[ip->k], compile(ip->k), memory_order_release);
+   BLOCK_EXIT(ip->k)
+ }
+
+void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
+ {
+   int input, cur, pc;
+
+   input = fgetc(source);
+   cur = 0;
+
+   while (EOF != input)
+    {
+      roi[cur] = input;
+      rod[cur] = 0;
+
+      input = fgetc(source);
+
+      while ((input >= '0') && (input <= '9'))
+       {
+         rod[cur] = rod[cur] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+
+//printf("loaded instruction %c%d\n", roi[cur], rod[cur]);
+      ++cur;
+      if (MEM == cur)
+       {
+         printf("error, program too big\n");
+         exit(4);
+       }
+    }
+
+      // Everything after the program, including instruction 255, is the pseudo-instruction "done", so
+      // compile() doesn't have to check for the end of memory.
+   for (pc = cur; pc < MEM; ++pc)
+    {
+      roi[pc] = 'D';
+      rod[pc] = 0;
+    }
+ }
+
+int main (int argc, char ** argv)
+ {
+   unsigned char rwd [MEM];
+   int pc;
+   FILE * infile;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      roi[pc] = 0;
+      rod[pc] = 0;
+      rwd[pc] = 0;
+    }
+
+   if (2 != argc)
+    {
+      printf("usage: GORBIT-ROM source_file\n");
+      return 2;
+    }
+   if (!imageLoad(argv[1], "ROM", roi, rod, NULL, NULL))
+    {
+      infile = fopen(argv[1], "r");
+      if (NULL == infile)
+       {
+         printf("cannot open input file\n");
+         return 3;
+       }
+      loadToMem(roi, rod, infile);
+      fclose(infile);
+      imageSave(roi, rod, NULL, 0);
+    }
+   ioInit();
+
+   blockInit(Compile);
+
+   stubs[0].handler(stubs, rwd, 0);
+
+   return 0;
+ }
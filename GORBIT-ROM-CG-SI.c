@@ -0,0 +1,417 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   GORBIT-ROM-CG, with superinstructions.
+
+   See GORBIT-ROM-TCO-SI for what these are and which idioms get fused.
+
+   NOTE: GCC is the only compiler that I know of that is capable of compiling this code!
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GORBIT-IO.h"
+
+/*
+G     ACC = MEM[IMM]
+O     MEM[IMM] = ACC
+R     ACC = INPUT
+B     BRZ IMM
+I     ACC += IMM
+T     PRINT ACC
+S     ACC = IMM
+A     ACC += MEM[IMM]
+
+g     ACC = MEM[MEM[IMM]]
+o     MEM[MEM[IMM]] = ACC
+r     MEM[IMM] = INPUT
+b     BRZ MEM[IMM]
+i     MEM[IMM] += ACC
+t     PRINT MEM[IMM]
+s     ACC ^= MEM[IMM]
+a     ACC += MEM[MEM[IMM]]
+
+Translation:
+   ACC      *acc
+   IMM      rod[*pc]
+   MEM      rwd
+*/
+
+#define MEM 256
+
+#include "GORBIT-IMAGE.h"
+
+#define DISPATCH \
+   ++pc; \
+   goto *operations[op[pc]];
+
+   // Superinstructions. Their opcodes can't come from a source file: see fuse().
+#define SB_OP     0x80
+#define Sb_OP     0x81
+#define GIOg_OP   0x82
+#define GIO_OP    0x83
+#define IO_OP     0x84
+#define Io_OP     0x85
+#define So_OP     0x86
+#define Si_OP     0x87
+#define Go_OP     0x88
+#define go_OP     0x89
+
+void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
+ {
+   int input, cur, pc;
+
+   input = fgetc(source);
+   cur = 0;
+
+   while (EOF != input)
+    {
+      roi[cur] = input;
+      rod[cur] = 0;
+
+      input = fgetc(source);
+
+      while ((input >= '0') && (input <= '9'))
+       {
+         rod[cur] = rod[cur] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+
+//printf("loaded instruction %c%d\n", roi[cur], rod[cur]);
+      ++cur;
+      if (MEM == cur)
+       {
+         printf("error, program too big\n");
+         exit(4);
+       }
+    }
+
+      // Everything after the program, including instruction 255, is the pseudo-instruction "done", so
+      // DISPATCH doesn't have to check for the end of memory.
+   for (pc = cur; pc < MEM; ++pc)
+    {
+      roi[pc] = 'D';
+      rod[pc] = 0;
+    }
+ }
+
+   // Is the sequence at pc the given opcodes?
+int matches(const unsigned char * roi, int pc, int length, const char * ops)
+ {
+   while ('\0' != *ops)
+    {
+      if ((pc >= length) || (roi[pc] != (unsigned char) *ops))
+       {
+         return 0;
+       }
+      ++pc;
+      ++ops;
+    }
+   return 1;
+ }
+
+void fuse(const unsigned char * roi, const unsigned char * rod, unsigned char * op, int length)
+ {
+   int pc;
+
+   for (pc = 0; pc < length; ++pc)
+    {
+      if (matches(roi, pc, length, "GIOg") && (rod[pc + 2] == rod[pc + 3]))
+       {
+         op[pc] = GIOg_OP;
+       }
+      else if (matches(roi, pc, length, "GIO"))
+       {
+         op[pc] = GIO_OP;
+       }
+      else if (matches(roi, pc, length, "SB") && (0 == rod[pc]))
+       {
+         op[pc] = SB_OP;
+       }
+      else if (matches(roi, pc, length, "Sb") && (0 == rod[pc]))
+       {
+         op[pc] = Sb_OP;
+       }
+      else if (matches(roi, pc, length, "IO"))
+       {
+         op[pc] = IO_OP;
+       }
+      else if (matches(roi, pc, length, "Io"))
+       {
+         op[pc] = Io_OP;
+       }
+      else if (matches(roi, pc, length, "So"))
+       {
+         op[pc] = So_OP;
+       }
+      else if (matches(roi, pc, length, "Si"))
+       {
+         op[pc] = Si_OP;
+       }
+      else if (matches(roi, pc, length, "Go"))
+       {
+         op[pc] = Go_OP;
+       }
+      else if (matches(roi, pc, length, "go"))
+       {
+         op[pc] = go_OP;
+       }
+      else if (roi[pc] & 0x80)
+       {
+         op[pc] = '?'; // Still illegal, but no longer a superinstruction.
+       }
+    }
+ }
+
+int main (int argc, char ** argv)
+ {
+   unsigned char roi [MEM], op [MEM], rod [MEM], rwd[MEM], acc;
+   int pc;
+   FILE * infile;
+
+   void * operations [] =
+    {
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&A, &&B, &&E, &&D, &&E, &&E, &&G, &&E, &&I, &&E, &&E, &&E, &&E, &&E, &&O,
+         &&E, &&E, &&R, &&S, &&T, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&a, &&b, &&E, &&E, &&E, &&E, &&g, &&E, &&i, &&E, &&E, &&E, &&E, &&E, &&o,
+         &&E, &&E, &&r, &&s, &&t, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&SB, &&Sb, &&GIOg, &&GIO, &&IO, &&Io, &&So, &&Si, &&Go, &&go, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E
+    };
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      rwd[pc] = 0;
+    }
+
+   if (2 != argc)
+    {
+      printf("usage: GORBIT-ROM source_file\n");
+      return 2;
+    }
+   if (!imageLoad(argv[1], "ROM", roi, rod, NULL, NULL))
+    {
+      infile = fopen(argv[1], "r");
+      if (NULL == infile)
+       {
+         printf("cannot open input file\n");
+         return 3;
+       }
+      loadToMem(roi, rod, infile);
+      fclose(infile);
+      imageSave(roi, rod, NULL, 0);
+    }
+      // The superinstructions go in op, and the program's own opcodes stay in roi, for E. Everything
+      // after the program is D, which starts no idiom, so all of it can be looked at.
+   memcpy(op, roi, MEM);
+   fuse(roi, rod, op, MEM);
+   ioInit();
+
+   pc = 0;
+   acc = 0;
+
+   goto *operations[op[pc]];
+
+
+G:
+   acc = rwd[rod[pc]];
+
+   DISPATCH
+
+O:
+   rwd[rod[pc]] = acc;
+
+   DISPATCH
+
+R:
+   acc = ioGet();
+
+   DISPATCH
+
+B:
+   if (0 == acc) pc = rod[pc] - 1;
+
+   DISPATCH
+
+I:
+   acc += rod[pc];
+
+   DISPATCH
+
+T:
+   ioPut(acc);
+
+   DISPATCH
+
+S:
+   acc = rod[pc];
+
+   DISPATCH
+
+A:
+   acc += rwd[rod[pc]];
+
+   DISPATCH
+
+g:
+   acc = rwd[rwd[rod[pc]]];
+
+   DISPATCH
+
+o:
+   rwd[rwd[rod[pc]]] = acc;
+
+   DISPATCH
+
+r:
+   rwd[rod[pc]] = ioGet();
+
+   DISPATCH
+
+b:
+   if (0 == acc) pc = rwd[rod[pc]] - 1;
+
+   DISPATCH
+
+i:
+   rwd[rod[pc]] += acc;
+
+   DISPATCH
+
+t:
+   ioPut(rwd[rod[pc]]);
+
+   DISPATCH
+
+s:
+   acc ^= rwd[rod[pc]];
+
+   DISPATCH
+
+a:
+   acc += rwd[rwd[rod[pc]]];
+
+   DISPATCH
+
+
+SB:
+   acc = 0;
+   pc = rod[pc + 1] - 1;
+
+   DISPATCH
+
+Sb:
+   acc = 0;
+   pc = rwd[rod[pc + 1]] - 1;
+
+   DISPATCH
+
+GIOg:
+   acc = rwd[rod[pc]] + rod[pc + 1];
+   rwd[rod[pc + 2]] = acc;
+   acc = rwd[acc];
+   pc += 3;
+
+   DISPATCH
+
+GIO:
+   acc = rwd[rod[pc]] + rod[pc + 1];
+   rwd[rod[pc + 2]] = acc;
+   pc += 2;
+
+   DISPATCH
+
+IO:
+   acc += rod[pc];
+   rwd[rod[pc + 1]] = acc;
+   ++pc;
+
+   DISPATCH
+
+Io:
+   acc += rod[pc];
+   rwd[rwd[rod[pc + 1]]] = acc;
+   ++pc;
+
+   DISPATCH
+
+So:
+   acc = rod[pc];
+   rwd[rwd[rod[pc + 1]]] = acc;
+   ++pc;
+
+   DISPATCH
+
+Si:
+   acc = rod[pc];
+   rwd[rod[pc + 1]] += acc;
+   ++pc;
+
+   DISPATCH
+
+Go:
+   acc = rwd[rod[pc]];
+   rwd[rwd[rod[pc + 1]]] = acc;
+   ++pc;
+
+   DISPATCH
+
+go:
+   acc = rwd[rwd[rod[pc]]];
+   rwd[rwd[rod[pc + 1]]] = acc;
+   ++pc;
+
+   DISPATCH
+
+
+E:
+   ioFlush();
+   printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, roi[pc], rod[pc]);
+   return 1;
+
+D:
+   return 0;
+ }
@@ -36,6 +36,7 @@ SUCH DAMAGE.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "GORBIT-IO.h"
 
 /*
 G     ACC = MEM[IMM]
@@ -64,14 +65,17 @@ Translation:
 
 #define MEM 256
 
+#include "GORBIT-PROFILE.h"
+#include "GORBIT-IMAGE.h"
+
 #define DISPATCH \
    ++pc; \
-   if (pc == (MEM - 1)) goto D; \
+   PROFILE_COUNT(pc); \
    goto *operations[roi[pc]];
 
 void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
  {
-   int input, cur;
+   int input, cur, pc;
 
    input = fgetc(source);
    cur = 0;
@@ -103,9 +107,12 @@ void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
        }
     }
 
-   if (MEM != cur)
+      // Everything after the program, including instruction 255, is the pseudo-instruction "done", so
+      // DISPATCH doesn't have to check for the end of memory.
+   for (pc = cur; pc < MEM; ++pc)
     {
-      roi[cur] = 'D'; // Pseudo-instruction "done"
+      roi[pc] = 'D';
+      rod[pc] = 0;
     }
  }
 
@@ -145,18 +152,25 @@ int main (int argc, char ** argv)
       printf("usage: GORBIT-ROM source_file\n");
       return 2;
     }
-   infile = fopen(argv[1], "r");
-   if (NULL == infile)
+   if (!imageLoad(argv[1], "ROM", roi, rod, NULL, NULL))
     {
-      printf("cannot open input file\n");
-      return 3;
+      infile = fopen(argv[1], "r");
+      if (NULL == infile)
+       {
+         printf("cannot open input file\n");
+         return 3;
+       }
+      loadToMem(roi, rod, infile);
+      fclose(infile);
+      imageSave(roi, rod, NULL, 0);
     }
-   loadToMem(roi, rod, infile);
-   fclose(infile);
+   ioInit();
+   profileInit(argv[1], roi, rod);
 
    pc = 0;
    acc = 0;
 
+   PROFILE_COUNT(pc);
    goto *operations[roi[pc]];
 
 
@@ -171,12 +185,16 @@ O:
    DISPATCH
 
 R:
-   acc = getchar();
+   acc = ioGet();
 
    DISPATCH
 
 B:
-   if (0 == acc) pc = rod[pc] - 1;
+   if (0 == acc)
+    {
+      PROFILE_TAKEN(pc);
+      pc = rod[pc] - 1;
+    }
 
    DISPATCH
 
@@ -186,7 +204,7 @@ I:
    DISPATCH
 
 T:
-   putchar(acc);
+   ioPut(acc);
 
    DISPATCH
 
@@ -211,12 +229,16 @@ o:
    DISPATCH
 
 r:
-   rwd[rod[pc]] = getchar();
+   rwd[rod[pc]] = ioGet();
 
    DISPATCH
 
 b:
-   if (0 == acc) pc = rwd[rod[pc]] - 1;
+   if (0 == acc)
+    {
+      PROFILE_TAKEN(pc);
+      pc = rwd[rod[pc]] - 1;
+    }
 
    DISPATCH
 
@@ -226,7 +248,7 @@ i:
    DISPATCH
 
 t:
-   putchar(rwd[rod[pc]]);
+   ioPut(rwd[rod[pc]]);
 
    DISPATCH
 
@@ -242,6 +264,7 @@ a:
 
 
 E:
+   ioFlush();
    printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, roi[pc], rod[pc]);
    return 1;
 
@@ -0,0 +1,177 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   The stencils of GORBIT-ROM-CP: GORBIT-ROM-TCO's handlers, with the immediate and the next handler
+   left as holes for the engine to fill in when it copies them. ACC is passed as an unsigned int, of
+   which only the low byte counts: GCC extends an unsigned char argument before every call, and these
+   are nothing but calls.
+
+   A hole is an undefined symbol. The immediate is the address of IMM, and the next handler is NEXT,
+   so GCC leaves relocations against them, at the places to patch. This is compiled into an object
+   file once, at -O2, and never linked: GORBIT-STENCIL reads the machine code and the relocations out
+   of it, and GORBIT-ROM-CP does the linking, once for every instruction of the program. Each handler
+   needs to be in its own section, and must not refer to anything but the holes: see STENCIL_FLAGS in
+   the Makefile.
+*/
+
+#include <stdint.h>
+
+#define MEM 256
+
+#include "GORBIT-CP.h"
+
+extern const unsigned char IMM [];
+extern const unsigned char PC [];
+void NEXT (unsigned char * rwd, unsigned int acc, const struct context * context);
+void TARGET (unsigned char * rwd, unsigned int acc, const struct context * context);
+
+   // The value of a hole (it's the symbol's address).
+#define HOLE(name) ((uintptr_t) name)
+
+void G (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   acc = rwd[HOLE(IMM)];
+
+   NEXT(rwd, acc, context);
+ }
+
+void O (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   rwd[HOLE(IMM)] = acc;
+
+   NEXT(rwd, acc, context);
+ }
+
+void R (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   acc = context->get();
+
+   NEXT(rwd, acc, context);
+ }
+
+void B (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   if (0 == (unsigned char) acc) TARGET(rwd, acc, context);
+   else NEXT(rwd, acc, context);
+ }
+
+void I (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   acc += HOLE(IMM);
+
+   NEXT(rwd, acc, context);
+ }
+
+void T (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   context->put((unsigned char) acc);
+
+   NEXT(rwd, acc, context);
+ }
+
+void S (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   acc = HOLE(IMM);
+
+   NEXT(rwd, acc, context);
+ }
+
+void A (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   acc += rwd[HOLE(IMM)];
+
+   NEXT(rwd, acc, context);
+ }
+
+void g (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   acc = rwd[rwd[HOLE(IMM)]];
+
+   NEXT(rwd, acc, context);
+ }
+
+void o (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   rwd[rwd[HOLE(IMM)]] = acc;
+
+   NEXT(rwd, acc, context);
+ }
+
+void r (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   rwd[HOLE(IMM)] = context->get();
+
+   NEXT(rwd, acc, context);
+ }
+
+void b (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   if (0 == (unsigned char) acc) context->code[rwd[HOLE(IMM)]](rwd, acc, context);
+   else NEXT(rwd, acc, context);
+ }
+
+void i (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   rwd[HOLE(IMM)] += acc;
+
+   NEXT(rwd, acc, context);
+ }
+
+void t (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   context->put(rwd[HOLE(IMM)]);
+
+   NEXT(rwd, acc, context);
+ }
+
+void s (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   acc ^= rwd[HOLE(IMM)];
+
+   NEXT(rwd, acc, context);
+ }
+
+void a (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   acc += rwd[rwd[HOLE(IMM)]];
+
+   NEXT(rwd, acc, context);
+ }
+
+void E (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   (void) rwd;
+   context->illegal(context, HOLE(PC), (unsigned char) acc);
+ }
+
+void D (unsigned char * rwd, unsigned int acc, const struct context * context)
+ {
+   (void) rwd; (void) acc; (void) context;
+ }
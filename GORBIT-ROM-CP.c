@@ -0,0 +1,290 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   Copy and patch: GORBIT-ROM-TCO's handlers, compiled by GCC, copied out one after another into
+   native code, one copy for every instruction of the program.
+
+   The handlers are the stencils in GORBIT-ROM-CP-STENCILS.c, compiled once, when this is built, with
+   their immediate and their next handler left as relocations. GORBIT-STENCIL turns those into the
+   header this includes (see GORBIT-CP.h). Translating a program is then two passes over it: one to
+   lay the copies out, and one to copy them and fill in their holes, with the immediate, the PC, and
+   the offsets to the next instruction's code and to the target of a B. There is no instruction
+   selection or register allocation to do here, as GCC already did it, once per handler.
+
+   What that buys over GORBIT-ROM-TCO is that the instruction's immediate is in the instruction, and
+   the next one is a direct jump, rather than loads from rod and operations and an indirect jump.
+   Most handlers end in that jump, and as its target is always the copy right after, the jump is left
+   out, and they fall through. B is a conditional jump to its target. b is still an indirect jump, to
+   the code of the instruction in the cell, which the context has the addresses of. The rest is what
+   GCC does with a handler: ACC and MEM stay in the argument registers, and a handler that calls
+   ioGet or ioPut saves them around the call.
+
+   Unlike the JIT, nothing is known about ACC or the cells between instructions, as every copy
+   starts from the calling convention. That is the price of not writing a code generator.
+
+   The stencils are x86-64 machine code, as is the object file GORBIT-STENCIL reads, so this only
+   builds on x86-64.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "GORBIT-IO.h"
+
+/*
+G     ACC = MEM[IMM]
+O     MEM[IMM] = ACC
+R     ACC = INPUT
+B     BRZ IMM
+I     ACC += IMM
+T     PRINT ACC
+S     ACC = IMM
+A     ACC += MEM[IMM]
+
+g     ACC = MEM[MEM[IMM]]
+o     MEM[MEM[IMM]] = ACC
+r     MEM[IMM] = INPUT
+b     BRZ MEM[IMM]
+i     MEM[IMM] += ACC
+t     PRINT MEM[IMM]
+s     ACC ^= MEM[IMM]
+a     ACC += MEM[MEM[IMM]]
+
+Translation:
+   ACC      the second argument
+   IMM      a hole
+   MEM      the first argument
+*/
+
+#define MEM 256
+
+#include "GORBIT-IMAGE.h"
+#include "GORBIT-CP.h"
+#include "GORBIT-ROM-CP-STENCILS.h"
+
+   // The stencil for each instruction: E, for ones that aren't.
+static const struct stencil * stencils [256];
+
+   // Whether the stencil ends with a jump to the next instruction, which can be left out.
+int fallsThrough (const struct stencil * stencil)
+ {
+   const struct hole * last;
+
+   if ((0 == stencil->numHoles) || (stencil->size < 5)) return 0;
+   last = stencil->holes + stencil->numHoles - 1;
+   return (0xE9 == stencil->code[stencil->size - 5]) && (HOLE_NEXT == last->what) && last->relative &&
+      (stencil->size - 4 == last->offset) && (-4 == last->addend);
+ }
+
+void findStencils (void)
+ {
+   int i;
+
+   for (i = 0; i < NUM_STENCILS; ++i)
+    {
+      stencils[stencilList[i].op] = stencilList + i;
+    }
+   for (i = 0; i < 256; ++i)
+    {
+      if (NULL == stencils[i]) stencils[i] = stencils['E'];
+    }
+ }
+
+   // Copy every instruction's stencil to where offset says, and fill in its holes.
+void patch (unsigned char * code, const int * offset, const unsigned char * roi, const unsigned char * rod)
+ {
+   const struct stencil * stencil;
+   const struct hole * hole;
+   long long value;
+   int pc, i, size, rel;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      stencil = stencils[roi[pc]];
+      size = offset[pc + 1] - offset[pc];
+      memcpy(code + offset[pc], stencil->code, size);
+      for (i = 0; i < stencil->numHoles; ++i)
+       {
+         hole = stencil->holes + i;
+         if (hole->offset + 4 > size) continue; // The jump that was left out.
+         switch (hole->what)
+          {
+         case HOLE_IMM:
+            value = rod[pc];
+            break;
+         case HOLE_PC:
+            value = pc;
+            break;
+         case HOLE_NEXT:
+            value = offset[(pc + 1) & (MEM - 1)];
+            break;
+         default:
+            value = offset[rod[pc]];
+            break;
+          }
+         if (hole->relative) value -= offset[pc] + hole->offset;
+         rel = (int) (value + hole->addend);
+         memcpy(code + offset[pc] + hole->offset, &rel, 4);
+       }
+    }
+ }
+
+   // The generated code calls these through the context.
+int get(void)
+ {
+   return ioGet();
+ }
+
+int put(int c)
+ {
+   return ioPut(c);
+ }
+
+void illegal(const struct context * context, int pc, int acc)
+ {
+   ioFlush();
+   printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, context->roi[pc], context->rod[pc]);
+   exit(1);
+ }
+
+void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
+ {
+   int input, cur, pc;
+
+   input = fgetc(source);
+   cur = 0;
+
+   while (EOF != input)
+    {
+      roi[cur] = input;
+      rod[cur] = 0;
+
+      input = fgetc(source);
+
+      while ((input >= '0') && (input <= '9'))
+       {
+         rod[cur] = rod[cur] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+
+//printf("loaded instruction %c%d\n", roi[cur], rod[cur]);
+      ++cur;
+      if (MEM == cur)
+       {
+         printf("error, program too big\n");
+         exit(4);
+       }
+    }
+
+      // Everything after the program, including instruction 255, is the pseudo-instruction "done",
+      // so the last instruction's copy never falls off the end of the code.
+   for (pc = cur; pc < MEM; ++pc)
+    {
+      roi[pc] = 'D';
+      rod[pc] = 0;
+    }
+ }
+
+int main (int argc, char ** argv)
+ {
+   unsigned char roi [MEM], rod [MEM], rwd[MEM];
+   int offset [MEM + 1];
+   int pc;
+   FILE * infile;
+   struct context context;
+   unsigned char * code;
+   size_t codeSize;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      rwd[pc] = 0;
+    }
+
+   if (2 != argc)
+    {
+      printf("usage: GORBIT-ROM source_file\n");
+      return 2;
+    }
+   if (!imageLoad(argv[1], "ROM", roi, rod, NULL, NULL))
+    {
+      infile = fopen(argv[1], "r");
+      if (NULL == infile)
+       {
+         printf("cannot open input file\n");
+         return 3;
+       }
+      loadToMem(roi, rod, infile);
+      fclose(infile);
+      imageSave(roi, rod, NULL, 0);
+    }
+   ioInit();
+   findStencils();
+
+      // Lay out the copies, then make them.
+   offset[0] = 0;
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      offset[pc + 1] = offset[pc] + stencils[roi[pc]]->size;
+      if ((pc < MEM - 1) && fallsThrough(stencils[roi[pc]])) offset[pc + 1] -= 5;
+    }
+   codeSize = offset[MEM];
+   code = mmap(NULL, codeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (MAP_FAILED == code)
+    {
+      printf("cannot allocate code buffer\n");
+      return 5;
+    }
+   patch(code, offset, roi, rod);
+   if (0 != mprotect(code, codeSize, PROT_READ | PROT_EXEC))
+    {
+      printf("cannot make code buffer executable\n");
+      return 5;
+    }
+
+   context.get = get;
+   context.put = put;
+   context.illegal = illegal;
+   context.roi = roi;
+   context.rod = rod;
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      context.code[pc] = (stencil) (code + offset[pc]);
+    }
+
+   ((stencil) code)(rwd, 0, &context);
+
+   return 0;
+ }
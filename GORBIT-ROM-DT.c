@@ -0,0 +1,334 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   GORBIT-ROM-TCO, direct threaded.
+
+   The TCO engine finds the next handler with operations[roi[pc]]: load the opcode, then load the
+   handler from the table. That second load depends on the first, and they are both on the path to
+   the indirect jump. But this is ROM: the code never changes. So, after loading, translate() does
+   the table lookup once for every instruction, and keeps the handler next to its immediate.
+   Dispatch is then a single load and an indirect jump through ip->handler.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "GORBIT-IO.h"
+#include "GORBIT-TAIL.h"
+
+/*
+G     ACC = MEM[IMM]
+O     MEM[IMM] = ACC
+R     ACC = INPUT
+B     BRZ IMM
+I     ACC += IMM
+T     PRINT ACC
+S     ACC = IMM
+A     ACC += MEM[IMM]
+
+g     ACC = MEM[MEM[IMM]]
+o     MEM[MEM[IMM]] = ACC
+r     MEM[IMM] = INPUT
+b     BRZ MEM[IMM]
+i     MEM[IMM] += ACC
+t     PRINT MEM[IMM]
+s     ACC ^= MEM[IMM]
+a     ACC += MEM[MEM[IMM]]
+
+Translation:
+   ACC      acc
+   IMM      ip->imm
+   MEM      rwd
+*/
+
+#define MEM 256
+
+#include "GORBIT-IMAGE.h"
+
+#define NEXT \
+   TAIL_CALL ip->handler(code, ip, rwd, acc);
+
+#define DISPATCH \
+   ++ip; \
+   NEXT
+
+struct insn;
+
+typedef void (TAIL_CC * handler)(const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc);
+
+struct insn
+ {
+   handler handler;
+   unsigned char imm;
+   unsigned char op;    // Only for the error message.
+ };
+
+extern handler operations[];
+
+TAIL_HANDLER void G (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc = rwd[ip->imm];
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void O (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   rwd[ip->imm] = acc;
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void R (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc = ioGet();
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void B (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   if (0 == acc) ip = code + ip->imm;
+   else ++ip;
+
+   NEXT
+ }
+
+TAIL_HANDLER void I (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc += ip->imm;
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void T (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   ioPut(acc);
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void S (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc = ip->imm;
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void A (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc += rwd[ip->imm];
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void g (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc = rwd[rwd[ip->imm]];
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void o (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   rwd[rwd[ip->imm]] = acc;
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void r (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   rwd[ip->imm] = ioGet();
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void b (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   if (0 == acc) ip = code + rwd[ip->imm];
+   else ++ip;
+
+   NEXT
+ }
+
+TAIL_HANDLER void i (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   rwd[ip->imm] += acc;
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void t (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   ioPut(rwd[ip->imm]);
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void s (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc ^= rwd[ip->imm];
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void a (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   acc += rwd[rwd[ip->imm]];
+
+   DISPATCH
+ }
+
+TAIL_HANDLER void E (const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   (void) rwd;
+   ioFlush();
+   printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", (int) (ip - code), acc, ip->op, ip->imm);
+   exit(1);
+ }
+
+TAIL_HANDLER void D(const struct insn * code, const struct insn * ip, unsigned char * rwd, unsigned char acc)
+ {
+   (void) code; (void) ip; (void) rwd; (void) acc;
+   return;
+ }
+
+handler operations[] =
+ {
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, A, B, E, D, E, E, G, E, I, E, E, E, E, E, O,
+   E, E, R, S, T, E, E, E, E, E, E, E, E, E, E, E,
+   E, a, b, E, E, E, E, g, E, i, E, E, E, E, E, o,
+   E, E, r, s, t, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
+   E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E
+ };
+
+void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
+ {
+   int input, cur, pc;
+
+   input = fgetc(source);
+   cur = 0;
+
+   while (EOF != input)
+    {
+      roi[cur] = input;
+      rod[cur] = 0;
+
+      input = fgetc(source);
+
+      while ((input >= '0') && (input <= '9'))
+       {
+         rod[cur] = rod[cur] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+
+//printf("loaded instruction %c%d\n", roi[cur], rod[cur]);
+      ++cur;
+      if (MEM == cur)
+       {
+         printf("error, program too big\n");
+         exit(4);
+       }
+    }
+
+      // Everything after the program, including instruction 255, is the pseudo-instruction "done", so
+      // DISPATCH doesn't have to check for the end of memory.
+   for (pc = cur; pc < MEM; ++pc)
+    {
+      roi[pc] = 'D';
+      rod[pc] = 0;
+    }
+ }
+
+void translate(struct insn * code, const unsigned char * roi, const unsigned char * rod)
+ {
+   int pc;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      code[pc].handler = operations[roi[pc]];
+      code[pc].imm = rod[pc];
+      code[pc].op = roi[pc];
+    }
+ }
+
+int main (int argc, char ** argv)
+ {
+   unsigned char roi [MEM], rod [MEM], rwd[MEM];
+   struct insn code [MEM];
+   int pc;
+   FILE * infile;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      roi[pc] = 0;
+      rod[pc] = 0;
+      rwd[pc] = 0;
+    }
+
+   if (2 != argc)
+    {
+      printf("usage: GORBIT-ROM source_file\n");
+      return 2;
+    }
+   if (!imageLoad(argv[1], "ROM", roi, rod, NULL, NULL))
+    {
+      infile = fopen(argv[1], "r");
+      if (NULL == infile)
+       {
+         printf("cannot open input file\n");
+         return 3;
+       }
+      loadToMem(roi, rod, infile);
+      fclose(infile);
+      imageSave(roi, rod, NULL, 0);
+    }
+   ioInit();
+   translate(code, roi, rod);
+
+   code[0].handler(code, code, rwd, 0);
+
+   return 0;
+ }
@@ -0,0 +1,433 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   An ahead-of-time compiler straight to an executable: GORBITSA-ROM to a static x86-64 Linux ELF
+   file, with no C compiler (or assembler, or linker) needed.
+
+   usage: GORBIT-ROM-ELF source_file executable
+
+   The program is compiled by the JIT's compiler (GORBIT-JIT.h), and the executable is that code
+   with just enough around it to run on its own: no libc, no dynamic linker, and nothing to parse.
+   Starting it is mapping it. There are two segments, at fixed addresses:
+      TEXT    the headers, the context, roi and rod, the illegal instruction message, the helpers,
+              and the code, read and execute
+      DATA    MEM and the I/O buffers, read and write, and not in the file at all (.bss)
+
+   The helpers are the JIT engine's get, put, and illegal, in machine code. Output is kept in a
+   buffer of BUFFER bytes, written with the write system call when it fills, when the program has
+   to wait for input, and at the end. Input is read BUFFER bytes at a time. That's GORBIT-IO.h,
+   without the mapping of a regular file on stdin. An illegal instruction writes the same message
+   the engines print, and exits with 1.
+
+   The entry point calls the code as the JIT does, with MEM and the context, and when the code
+   returns (the program got to its end), flushes the output and exits with 0.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <elf.h>
+
+/*
+G     ACC = MEM[IMM]
+O     MEM[IMM] = ACC
+R     ACC = INPUT
+B     BRZ IMM
+I     ACC += IMM
+T     PRINT ACC
+S     ACC = IMM
+A     ACC += MEM[IMM]
+
+g     ACC = MEM[MEM[IMM]]
+o     MEM[MEM[IMM]] = ACC
+r     MEM[IMM] = INPUT
+b     BRZ MEM[IMM]
+i     MEM[IMM] += ACC
+t     PRINT MEM[IMM]
+s     ACC ^= MEM[IMM]
+a     ACC += MEM[MEM[IMM]]
+
+Translation:
+   ACC      %bl
+   IMM      rod[pc]
+   MEM      -128(%rbp), in .bss
+*/
+
+#define MEM 256
+
+#include "GORBIT-JIT.h"
+
+#define TEXT 0x400000
+#define DATA 0x600000
+#define PAGE 4096
+#define BUFFER 4096
+
+   // Where things are in the file, which is mapped at TEXT.
+#define NUM_SEGMENTS 3  // TEXT, DATA, and the one that says the stack isn't executable
+#define AT_CONTEXT  (sizeof(Elf64_Ehdr) + NUM_SEGMENTS * sizeof(Elf64_Phdr))
+#define AT_ROI      (AT_CONTEXT + 3 * 8)
+#define AT_ROD      (AT_ROI + MEM)
+#define AT_MESSAGE  (AT_ROD + MEM)
+
+   // Where things are in DATA.
+#define MEM_AT      DATA
+#define OUT_SIZE    (DATA + MEM)       // int
+#define IN_POS      (DATA + MEM + 4)   // int
+#define IN_SIZE     (DATA + MEM + 8)   // int
+#define OUT_BUFFER  (DATA + 2 * MEM)
+#define IN_BUFFER   (OUT_BUFFER + BUFFER)
+#define DATA_SIZE   (2 * MEM + 2 * BUFFER)
+
+   // The message for an illegal instruction, in the three pieces around the numbers.
+static const char * message [] =
+ {
+   "Attempt to execute illegal instruction at program counter ",
+   ". Accumulator: ",
+   ". Instruction: "
+ };
+
+   // Where the helpers are in the file.
+static int flushAt, putAt, getAt, numberAt, illegalAt, startAt;
+
+   // The file is built with the JIT's emit1 and emit4, in a struct jit of its own.
+void emitCallTo(struct jit * out, int at)
+ {
+   emit1(out, 0xE8); emit4(out, at - (out->size + 4));                      // call at
+ }
+
+void emitAlign(struct jit * out)
+ {
+   while (0 != (out->size & 15))
+    {
+      emit1(out, 0xCC);
+    }
+ }
+
+   // Write out the output buffer. The only helper the others call.
+void emitFlush(struct jit * out)
+ {
+   flushAt = out->size;
+   emit1(out, 0x8B); emit1(out, 0x14); emit1(out, 0x25); emit4(out, OUT_SIZE);   // mov OUT_SIZE, %edx
+   emit1(out, 0xBE); emit4(out, OUT_BUFFER);                                      // mov $OUT_BUFFER, %esi
+   emit1(out, 0x85); emit1(out, 0xD2);                                            // loop: test %edx, %edx
+   emit1(out, 0x7E); emit1(out, 0x18);                                            // jle done
+   emit1(out, 0xBF); emit4(out, 1);                                               // mov $1, %edi (stdout)
+   emit1(out, 0xB8); emit4(out, 1);                                               // mov $1, %eax (write)
+   emit1(out, 0x0F); emit1(out, 0x05);                                            // syscall
+   emit1(out, 0x48); emit1(out, 0x85); emit1(out, 0xC0);                          // test %rax, %rax
+   emit1(out, 0x7E); emit1(out, 0x07);                                            // jle done (an error: give up)
+   emit1(out, 0x48); emit1(out, 0x01); emit1(out, 0xC6);                          // add %rax, %rsi
+   emit1(out, 0x29); emit1(out, 0xC2);                                            // sub %eax, %edx
+   emit1(out, 0xEB); emit1(out, 0xE4);                                            // jmp loop
+   emit1(out, 0xC7); emit1(out, 0x04); emit1(out, 0x25); emit4(out, OUT_SIZE); emit4(out, 0);  // done: movl $0, OUT_SIZE
+   emit1(out, 0xC3);                                                              // ret
+ }
+
+   // put(%edi)
+void emitPut(struct jit * out)
+ {
+   putAt = out->size;
+   emit1(out, 0x8B); emit1(out, 0x04); emit1(out, 0x25); emit4(out, OUT_SIZE);   // mov OUT_SIZE, %eax
+   emit1(out, 0x40); emit1(out, 0x88); emit1(out, 0xB8); emit4(out, OUT_BUFFER); // mov %dil, OUT_BUFFER(%rax)
+   emit1(out, 0xFF); emit1(out, 0xC0);                                            // inc %eax
+   emit1(out, 0x89); emit1(out, 0x04); emit1(out, 0x25); emit4(out, OUT_SIZE);   // mov %eax, OUT_SIZE
+   emit1(out, 0x3D); emit4(out, BUFFER);                                          // cmp $BUFFER, %eax
+   emit1(out, 0x74); emit1(out, flushAt - (out->size + 1));                       // je flush
+   emit1(out, 0xC3);                                                              // ret
+ }
+
+   // get() in %eax: the next character, or EOF.
+void emitGet(struct jit * out)
+ {
+   getAt = out->size;
+   emit1(out, 0x8B); emit1(out, 0x04); emit1(out, 0x25); emit4(out, IN_POS);     // mov IN_POS, %eax
+   emit1(out, 0x3B); emit1(out, 0x04); emit1(out, 0x25); emit4(out, IN_SIZE);    // cmp IN_SIZE, %eax
+   emit1(out, 0x72); emit1(out, 0x23);                                            // jb next
+   emitCallTo(out, flushAt);                                                      // call flush
+   emit1(out, 0x31); emit1(out, 0xC0);                                            // xor %eax, %eax (read)
+   emit1(out, 0x31); emit1(out, 0xFF);                                            // xor %edi, %edi (stdin)
+   emit1(out, 0xBE); emit4(out, IN_BUFFER);                                       // mov $IN_BUFFER, %esi
+   emit1(out, 0xBA); emit4(out, BUFFER);                                          // mov $BUFFER, %edx
+   emit1(out, 0x0F); emit1(out, 0x05);                                            // syscall
+   emit1(out, 0x48); emit1(out, 0x85); emit1(out, 0xC0);                          // test %rax, %rax
+   emit1(out, 0x7E); emit1(out, 0x1B);                                            // jle eof
+   emit1(out, 0x89); emit1(out, 0x04); emit1(out, 0x25); emit4(out, IN_SIZE);    // mov %eax, IN_SIZE
+   emit1(out, 0x31); emit1(out, 0xC0);                                            // xor %eax, %eax
+   emit1(out, 0x8D); emit1(out, 0x50); emit1(out, 0x01);                          // next: lea 1(%rax), %edx
+   emit1(out, 0x89); emit1(out, 0x14); emit1(out, 0x25); emit4(out, IN_POS);     // mov %edx, IN_POS
+   emit1(out, 0x0F); emit1(out, 0xB6); emit1(out, 0x80); emit4(out, IN_BUFFER);  // movzbl IN_BUFFER(%rax), %eax
+   emit1(out, 0xC3);                                                              // ret
+   emit1(out, 0xB8); emit4(out, -1);                                              // eof: mov $-1, %eax
+   emit1(out, 0xC3);                                                              // ret
+ }
+
+   // %eax, in decimal, at (%rdi), which it moves past. The digits go onto the stack backwards.
+void emitNumber(struct jit * out)
+ {
+   numberAt = out->size;
+   emit1(out, 0xB9); emit4(out, 10);                                              // mov $10, %ecx
+   emit1(out, 0x45); emit1(out, 0x31); emit1(out, 0xC0);                          // xor %r8d, %r8d
+   emit1(out, 0x31); emit1(out, 0xD2);                                            // divide: xor %edx, %edx
+   emit1(out, 0xF7); emit1(out, 0xF1);                                            // div %ecx
+   emit1(out, 0x52);                                                              // push %rdx
+   emit1(out, 0x41); emit1(out, 0xFF); emit1(out, 0xC0);                          // inc %r8d
+   emit1(out, 0x85); emit1(out, 0xC0);                                            // test %eax, %eax
+   emit1(out, 0x75); emit1(out, 0xF4);                                            // jne divide
+   emit1(out, 0x58);                                                              // digit: pop %rax
+   emit1(out, 0x04); emit1(out, '0');                                             // add $'0', %al
+   emit1(out, 0xAA);                                                              // stosb
+   emit1(out, 0x41); emit1(out, 0xFF); emit1(out, 0xC8);                          // dec %r8d
+   emit1(out, 0x75); emit1(out, 0xF7);                                            // jne digit
+   emit1(out, 0xC3);                                                              // ret
+ }
+
+   // illegal(context, %esi = pc, %edx = ACC): it doesn't return, so it can use any register.
+void emitIllegal(struct jit * out)
+ {
+   illegalAt = out->size;
+   emit1(out, 0x41); emit1(out, 0x89); emit1(out, 0xF4);                          // mov %esi, %r12d
+   emit1(out, 0x41); emit1(out, 0x89); emit1(out, 0xD5);                          // mov %edx, %r13d
+   emitCallTo(out, flushAt);                                                      // call flush
+   emit1(out, 0xBF); emit4(out, OUT_BUFFER);                                      // mov $OUT_BUFFER, %edi
+   emit1(out, 0xBE); emit4(out, TEXT + AT_MESSAGE);                               // mov $message, %esi
+   emit1(out, 0xB9); emit4(out, strlen(message[0]));                              // mov $length, %ecx
+   emit1(out, 0xF3); emit1(out, 0xA4);                                            // rep movsb
+   emit1(out, 0x44); emit1(out, 0x89); emit1(out, 0xE0);                          // mov %r12d, %eax
+   emitCallTo(out, numberAt);                                                     // call number
+   emit1(out, 0xB9); emit4(out, strlen(message[1]));                              // mov $length, %ecx
+   emit1(out, 0xF3); emit1(out, 0xA4);                                            // rep movsb
+   emit1(out, 0x44); emit1(out, 0x89); emit1(out, 0xE8);                          // mov %r13d, %eax
+   emitCallTo(out, numberAt);                                                     // call number
+   emit1(out, 0xB9); emit4(out, strlen(message[2]));                              // mov $length, %ecx
+   emit1(out, 0xF3); emit1(out, 0xA4);                                            // rep movsb
+   emit1(out, 0x41); emit1(out, 0x0F); emit1(out, 0xB6); emit1(out, 0x84); emit1(out, 0x24);
+   emit4(out, TEXT + AT_ROI);                                                     // movzbl roi(%r12), %eax
+   emit1(out, 0xAA);                                                              // stosb
+   emit1(out, 0x41); emit1(out, 0x0F); emit1(out, 0xB6); emit1(out, 0x84); emit1(out, 0x24);
+   emit4(out, TEXT + AT_ROD);                                                     // movzbl rod(%r12), %eax
+   emitCallTo(out, numberAt);                                                     // call number
+   emit1(out, 0x81); emit1(out, 0xEF); emit4(out, OUT_BUFFER);                    // sub $OUT_BUFFER, %edi
+   emit1(out, 0x89); emit1(out, 0x3C); emit1(out, 0x25); emit4(out, OUT_SIZE);   // mov %edi, OUT_SIZE
+   emitCallTo(out, flushAt);                                                      // call flush
+   emit1(out, 0xB8); emit4(out, 231);                                             // mov $231, %eax (exit_group)
+   emit1(out, 0xBF); emit4(out, 1);                                               // mov $1, %edi
+   emit1(out, 0x0F); emit1(out, 0x05);                                            // syscall
+ }
+
+   // The entry point. Returns where the call to the code is, to be filled in.
+int emitStart(struct jit * out)
+ {
+   int call;
+
+   startAt = out->size;
+   emit1(out, 0xBF); emit4(out, MEM_AT);                                          // mov $MEM, %edi
+   emit1(out, 0xBE); emit4(out, TEXT + AT_CONTEXT);                               // mov $context, %esi
+   emit1(out, 0xE8);                                                              // call code
+   call = out->size;
+   emit4(out, 0);
+   emitCallTo(out, flushAt);                                                      // call flush
+   emit1(out, 0xB8); emit4(out, 231);                                             // mov $231, %eax (exit_group)
+   emit1(out, 0x31); emit1(out, 0xFF);                                            // xor %edi, %edi
+   emit1(out, 0x0F); emit1(out, 0x05);                                            // syscall
+   return call;
+ }
+
+void emitAddress(struct jit * out, int at)
+ {
+   emit4(out, TEXT + at);
+   emit4(out, 0);
+ }
+
+   // The whole file, with the compiled program in jit.
+void makeExecutable(struct jit * out, const struct jit * jit, const unsigned char * roi, const unsigned char * rod)
+ {
+   Elf64_Ehdr header;
+   Elf64_Phdr segments [NUM_SEGMENTS];
+   int call, code, rel, i;
+
+   out->size = AT_CONTEXT;
+   emitAddress(out, 0); // get, put, and illegal: filled in below
+   emitAddress(out, 0);
+   emitAddress(out, 0);
+   for (i = 0; i < MEM; ++i) emit1(out, roi[i]);
+   for (i = 0; i < MEM; ++i) emit1(out, rod[i]);
+   for (i = 0; i < 3; ++i)
+    {
+      memcpy(out->code + out->size, message[i], strlen(message[i]));
+      out->size += strlen(message[i]);
+    }
+
+   emitAlign(out);
+   emitFlush(out);
+   emitPut(out);
+   emitGet(out);
+   emitNumber(out);
+   emitIllegal(out);
+   call = emitStart(out);
+
+   emitAlign(out);
+   code = out->size;
+   memcpy(out->code + out->size, jit->code, jit->size);
+   out->size += jit->size;
+   rel = code - (call + 4);
+   memcpy(out->code + call, &rel, 4);
+
+   out->size = AT_CONTEXT;
+   emitAddress(out, getAt);
+   emitAddress(out, putAt);
+   emitAddress(out, illegalAt);
+   out->size = code + jit->size;
+
+   memset(&header, 0, sizeof(header));
+   memcpy(header.e_ident, ELFMAG, SELFMAG);
+   header.e_ident[EI_CLASS] = ELFCLASS64;
+   header.e_ident[EI_DATA] = ELFDATA2LSB;
+   header.e_ident[EI_VERSION] = EV_CURRENT;
+   header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+   header.e_type = ET_EXEC;
+   header.e_machine = EM_X86_64;
+   header.e_version = EV_CURRENT;
+   header.e_entry = TEXT + startAt;
+   header.e_phoff = sizeof(header);
+   header.e_ehsize = sizeof(header);
+   header.e_phentsize = sizeof(Elf64_Phdr);
+   header.e_phnum = NUM_SEGMENTS;
+   memcpy(out->code, &header, sizeof(header));
+
+   memset(segments, 0, sizeof(segments));
+   segments[0].p_type = PT_LOAD;
+   segments[0].p_flags = PF_R | PF_X;
+   segments[0].p_vaddr = segments[0].p_paddr = TEXT;
+   segments[0].p_filesz = segments[0].p_memsz = out->size;
+   segments[0].p_align = PAGE;
+   segments[1].p_type = PT_LOAD;
+   segments[1].p_flags = PF_R | PF_W;
+   segments[1].p_vaddr = segments[1].p_paddr = DATA;
+   segments[1].p_memsz = DATA_SIZE;
+   segments[1].p_align = PAGE;
+   segments[2].p_type = PT_GNU_STACK;
+   segments[2].p_flags = PF_R | PF_W;
+   memcpy(out->code + sizeof(header), segments, sizeof(segments));
+ }
+
+void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
+ {
+   int input, cur, pc;
+
+   input = fgetc(source);
+   cur = 0;
+
+   while (EOF != input)
+    {
+      roi[cur] = input;
+      rod[cur] = 0;
+
+      input = fgetc(source);
+
+      while ((input >= '0') && (input <= '9'))
+       {
+         rod[cur] = rod[cur] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+
+//printf("loaded instruction %c%d\n", roi[cur], rod[cur]);
+      ++cur;
+      if (MEM == cur)
+       {
+         printf("error, program too big\n");
+         exit(4);
+       }
+    }
+
+   for (pc = cur; pc < MEM; ++pc)
+    {
+      roi[pc] = 'D'; // Pseudo-instruction "done"
+      rod[pc] = 0;
+    }
+ }
+
+int main (int argc, char ** argv)
+ {
+   static struct jit jit, out;
+   unsigned char roi [MEM], rod [MEM];
+   FILE * infile;
+   ssize_t wrote;
+   int fd, done;
+
+   if (3 != argc)
+    {
+      printf("usage: GORBIT-ROM-ELF source_file executable\n");
+      return 2;
+    }
+   infile = fopen(argv[1], "r");
+   if (NULL == infile)
+    {
+      printf("cannot open input file\n");
+      return 3;
+    }
+   loadToMem(roi, rod, infile);
+   fclose(infile);
+
+   jit.code = malloc(CODE_SIZE);
+   out.code = malloc(PAGE + CODE_SIZE);
+   if ((NULL == jit.code) || (NULL == out.code))
+    {
+      printf("out of memory\n");
+      return 5;
+    }
+   compile(&jit, roi, rod);
+   makeExecutable(&out, &jit, roi, rod);
+
+   fd = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0755);
+   if (-1 == fd)
+    {
+      printf("cannot open output file\n");
+      return 3;
+    }
+   for (done = 0; done < out.size; done += wrote)
+    {
+      wrote = write(fd, out.code + done, out.size - done);
+      if (wrote <= 0)
+       {
+         printf("cannot write output file\n");
+         return 3;
+       }
+    }
+   close(fd);
+
+   return 0;
+ }
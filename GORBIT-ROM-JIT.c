@@ -0,0 +1,210 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   The archane scheme: a JIT compiler for GORBITSA-ROM, targeting x86-64.
+
+   The whole program (all 255 instructions that can execute) is translated up front into one
+   native function, by the compiler in GORBIT-JIT.h, and then called. The code calls this file's
+   get, put, and illegal through the context, so it holds no addresses, and GORBIT-IMAGE.h can keep
+   it in the program cache and map it back in anywhere.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "GORBIT-IO.h"
+
+/*
+G     ACC = MEM[IMM]
+O     MEM[IMM] = ACC
+R     ACC = INPUT
+B     BRZ IMM
+I     ACC += IMM
+T     PRINT ACC
+S     ACC = IMM
+A     ACC += MEM[IMM]
+
+g     ACC = MEM[MEM[IMM]]
+o     MEM[MEM[IMM]] = ACC
+r     MEM[IMM] = INPUT
+b     BRZ MEM[IMM]
+i     MEM[IMM] += ACC
+t     PRINT MEM[IMM]
+s     ACC ^= MEM[IMM]
+a     ACC += MEM[MEM[IMM]]
+
+Translation:
+   ACC      %bl
+   IMM      rod[pc]
+   MEM      -128(%rbp)
+*/
+
+#define MEM 256
+
+#include "GORBIT-IMAGE.h"
+
+   // The kind of image the cache keeps for the JIT: the code changes whenever the JIT does.
+#define JIT_IMAGE "JIT " __DATE__ " " __TIME__
+
+#include "GORBIT-JIT.h"
+
+struct context
+ {
+   int (*get) (void);
+   int (*put) (int);
+   void (*illegal) (struct context * context, int pc, int acc);
+   const unsigned char * roi;
+   const unsigned char * rod;
+ };
+
+   // The generated code calls these through the context.
+int get(void)
+ {
+   return ioGet();
+ }
+
+int put(int c)
+ {
+   return ioPut(c);
+ }
+
+void illegal(struct context * context, int pc, int acc)
+ {
+   ioFlush();
+   printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, context->roi[pc], context->rod[pc]);
+   exit(1);
+ }
+
+void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
+ {
+   int input, cur, pc;
+
+   input = fgetc(source);
+   cur = 0;
+
+   while (EOF != input)
+    {
+      roi[cur] = input;
+      rod[cur] = 0;
+
+      input = fgetc(source);
+
+      while ((input >= '0') && (input <= '9'))
+       {
+         rod[cur] = rod[cur] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+
+//printf("loaded instruction %c%d\n", roi[cur], rod[cur]);
+      ++cur;
+      if (MEM == cur)
+       {
+         printf("error, program too big\n");
+         exit(4);
+       }
+    }
+
+   for (pc = cur; pc < MEM; ++pc)
+    {
+      roi[pc] = 'D'; // Pseudo-instruction "done"
+      rod[pc] = 0;
+    }
+ }
+
+int main (int argc, char ** argv)
+ {
+   unsigned char roi [MEM], rod [MEM], rwd[MEM];
+   int pc;
+   FILE * infile;
+   struct jit jit;
+   struct context context;
+   const void * code;
+   size_t codeSize;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      roi[pc] = 0;
+      rod[pc] = 0;
+      rwd[pc] = 0;
+    }
+
+   if (2 != argc)
+    {
+      printf("usage: GORBIT-ROM source_file\n");
+      return 2;
+    }
+   if (!imageLoad(argv[1], JIT_IMAGE, roi, rod, &code, &codeSize))
+    {
+      infile = fopen(argv[1], "r");
+      if (NULL == infile)
+       {
+         printf("cannot open input file\n");
+         return 3;
+       }
+      loadToMem(roi, rod, infile);
+      fclose(infile);
+    }
+   ioInit();
+
+      // Compile, unless the code came from the cache.
+   if (NULL == code)
+    {
+      jit.code = mmap(NULL, CODE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (MAP_FAILED == jit.code)
+       {
+         printf("cannot allocate code buffer\n");
+         return 5;
+       }
+      compile(&jit, roi, rod);
+      imageSave(roi, rod, jit.code, jit.size);
+      if (0 != mprotect(jit.code, CODE_SIZE, PROT_READ | PROT_EXEC))
+       {
+         printf("cannot make code buffer executable\n");
+         return 5;
+       }
+      code = jit.code;
+    }
+
+   context.get = get;
+   context.put = put;
+   context.illegal = illegal;
+   context.roi = roi;
+   context.rod = rod;
+
+   ((void (*) (unsigned char *, struct context *)) code)(rwd, &context);
+
+   return 0;
+ }
@@ -0,0 +1,150 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   An engine made out of libgorbitsa (see gorbitsa.h): it does what the others do, and is as much
+   an example of using the library as anything.
+
+   usage: GORBIT-ROM-LIB source_file
+
+   It runs the program SLICE instructions at a time, which is pointless here, but is how a host
+   that has other things to do would run it. Input is read a buffer at a time when the machine
+   asks for it, and output is written when the machine's buffer fills, when it asks for input,
+   and at the end.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include "gorbitsa.h"
+
+#define SLICE 1000000
+#define BUFFER 65536
+
+   // Write out and empty the machine's output.
+void drain (struct gorbitsa * vm)
+ {
+   size_t done;
+   ssize_t wrote;
+
+   done = 0;
+   while (done < vm->outputSize)
+    {
+      wrote = write(STDOUT_FILENO, vm->output + done, vm->outputSize - done);
+      if (wrote > 0)
+       {
+         done += wrote;
+       }
+      else if ((wrote < 0) && (EINTR != errno))
+       {
+         break;
+       }
+    }
+   vm->outputSize = 0;
+ }
+
+int main (int argc, char ** argv)
+ {
+   static struct gorbitsa vm;
+   static unsigned char input [BUFFER];
+   char * text;
+   long size;
+   ssize_t got;
+   int status;
+   FILE * infile;
+
+   if (2 != argc)
+    {
+      printf("usage: GORBIT-ROM-LIB source_file\n");
+      return 2;
+    }
+   infile = fopen(argv[1], "r");
+   if (NULL == infile)
+    {
+      printf("cannot open input file\n");
+      return 3;
+    }
+   fseek(infile, 0, SEEK_END);
+   size = ftell(infile);
+   rewind(infile);
+   text = (size < 0) ? NULL : malloc(size + 1);
+   if ((NULL == text) || ((size_t) size != fread(text, 1, size, infile)))
+    {
+      printf("cannot read input file\n");
+      return 3;
+    }
+   fclose(infile);
+
+   if (!gorbitsaLoad(&vm, text, size))
+    {
+      printf("error, program too big\n");
+      return 4;
+    }
+   free(text);
+
+   for (;;)
+    {
+      status = gorbitsaRun(&vm, SLICE);
+      if (GORBITSA_OUTPUT == status)
+       {
+         drain(&vm);
+       }
+      else if (GORBITSA_INPUT == status)
+       {
+         drain(&vm);
+         do
+          {
+            got = read(STDIN_FILENO, input, BUFFER);
+          }
+         while ((got < 0) && (EINTR == errno));
+         if (got > 0)
+          {
+            gorbitsaInput(&vm, input, got);
+          }
+         else
+          {
+            gorbitsaEndInput(&vm);
+          }
+       }
+      else if (GORBITSA_BUDGET != status)
+       {
+         break;
+       }
+    }
+   drain(&vm);
+
+   if (GORBITSA_TRAP == status)
+    {
+      printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", vm.pc, vm.acc, vm.roi[vm.pc], vm.rod[vm.pc]);
+      return 1;
+    }
+
+   return 0;
+ }
@@ -0,0 +1,472 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   The switch engine, remembering what calls did, so that a call made again with the same inputs is
+   skipped.
+
+   GORBITSA has no call instruction, but programs make calls all the same: store the address to come
+   back to, jump to the routine, and have it come back with a b through where that was stored.
+   Bench.txt's Ackermann does this, and it makes the same calls, with the same arguments, at the same
+   depth, over and over: all 62500 of its Ackermann(3, 3)s are the same computation.
+
+   What's recognized as a call is a taken jump from the instruction before a return point, which is
+   anywhere a b has gone. The call's region runs from the routine it jumps to until a b comes back to
+   the instruction after the jump. While a region runs, every cell it reads before writing is recorded
+   (with the value it had), as is every cell it writes. If the region gets to its end without doing
+   any I/O, what it did is kept: from the routine's PC, ACC, and the values of the cells it read, it
+   got to the end with this ACC, and wrote these values to these cells. The next call to the routine
+   that finds the same ACC and the same values in those cells does exactly the same thing, as nothing
+   else goes into it, so instead of running it, the engine writes the cells, sets ACC, and goes to
+   the end. Regions nest, as calls do, and a region skipped inside another counts as reading and
+   writing what it did, for the one outside it.
+
+   The table is a tree for each routine and ACC, as which cell a region reads next depends only on
+   what it has read so far: each node says which cell to look at next, and its children are for the
+   values that cell can have. A leaf is a result. The table is a fixed size, and is emptied when it
+   fills up. Which cells were read and written since a region started is kept by time: each region has
+   the time it started, and each cell the time it was last touched and last written, so a region
+   learns of a cell the first time it touches it, and never again.
+
+   Wherever the regions end, this is only ever right: a region that got from its start to its end on
+   these values will do so again on them. A call with no return (a tail call) ends with whichever call
+   it came from, a region that does I/O is thrown away, and one nested MAX_DEPTH deep isn't recorded,
+   so that its return ends the one outside it early.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GORBIT-IO.h"
+
+/*
+G     ACC = MEM[IMM]
+O     MEM[IMM] = ACC
+R     ACC = INPUT
+B     BRZ IMM
+I     ACC += IMM
+T     PRINT ACC
+S     ACC = IMM
+A     ACC += MEM[IMM]
+
+g     ACC = MEM[MEM[IMM]]
+o     MEM[MEM[IMM]] = ACC
+r     MEM[IMM] = INPUT
+b     BRZ MEM[IMM]
+i     MEM[IMM] += ACC
+t     PRINT MEM[IMM]
+s     ACC ^= MEM[IMM]
+a     ACC += MEM[MEM[IMM]]
+
+Translation:
+   ACC      acc
+   IMM      rod[pc]
+   MEM      rwd, through load and store
+*/
+
+#define MEM 256
+
+#include "GORBIT-IMAGE.h"
+
+#define MAX_DEPTH 64        // Regions being recorded at once.
+#define NODE_BITS 16
+#define NODES (1 << NODE_BITS)
+#define WRITES (1 << 18)    // Cells written, by all of the results in the table together.
+
+   // What a node is, besides which cell to read next.
+#define RESULT -1
+#define FRESH  -2
+
+   // A call being recorded.
+struct region
+ {
+   int entry, exit;
+   unsigned char acc;
+   unsigned int start;
+   int numReads, numWrites;
+   unsigned char readCells [MEM], readValues [MEM], writeCells [MEM];
+ };
+
+struct node
+ {
+   unsigned int key;        // ROOT(entry, acc), or CHILD(parent, value of the parent's cell)
+   unsigned int generation; // The node is only there if this is the table's.
+   int cell;                // To read next, or RESULT or FRESH.
+   unsigned char exit, acc; // A result: where it ends, and ACC there,
+   int writes, numWrites;   // and what it writes, in poolCells and poolValues.
+ };
+
+#define ROOT(entry, acc)      (((unsigned int) (NODES + (entry)) << 8) | (acc))
+#define CHILD(parent, value)  (((unsigned int) (parent) << 8) | (value))
+
+static struct region regions [MAX_DEPTH];
+static int depth;
+static unsigned int now, touched [MEM], written [MEM];
+static unsigned char returnPoint [MEM];
+
+static struct node nodes [NODES];
+static unsigned int generation = 1;
+static int numNodes;
+static unsigned char poolCells [WRITES], poolValues [WRITES];
+static int poolSize;
+
+   // A cell touched for the first time by at least the innermost region, and maybe more.
+void noteRead (const unsigned char * rwd, int cell)
+ {
+   struct region * region;
+   int i;
+
+   for (i = depth - 1; (i >= 0) && (touched[cell] < regions[i].start); --i)
+    {
+      region = regions + i;
+      region->readCells[region->numReads] = cell;
+      region->readValues[region->numReads] = rwd[cell];
+      ++region->numReads;
+    }
+   touched[cell] = now;
+ }
+
+void noteWrite (int cell)
+ {
+   struct region * region;
+   int i;
+
+   for (i = depth - 1; (i >= 0) && (written[cell] < regions[i].start); --i)
+    {
+      region = regions + i;
+      region->writeCells[region->numWrites] = cell;
+      ++region->numWrites;
+    }
+   touched[cell] = now;
+   written[cell] = now;
+ }
+
+   // Every access to MEM goes through these. With no region being recorded, they're just the access.
+static inline unsigned char load (const unsigned char * rwd, int cell)
+ {
+   if ((0 != depth) && (touched[cell] < regions[depth - 1].start)) noteRead(rwd, cell);
+   return rwd[cell];
+ }
+
+static inline void store (unsigned char * rwd, int cell, unsigned char value)
+ {
+   if ((0 != depth) && (written[cell] < regions[depth - 1].start)) noteWrite(cell);
+   rwd[cell] = value;
+ }
+
+int find (unsigned int key, int create)
+ {
+   unsigned int i;
+
+   i = (key * 2654435761u) >> (32 - NODE_BITS);
+   while (generation == nodes[i].generation)
+    {
+      if (key == nodes[i].key) return i;
+      i = (i + 1) & (NODES - 1);
+    }
+   if (!create) return -1;
+   nodes[i].key = key;
+   nodes[i].generation = generation;
+   nodes[i].cell = FRESH;
+   ++numNodes;
+   return i;
+ }
+
+   // Keep what a region did, now that it has got to its end.
+void save (const unsigned char * rwd, const struct region * region, int exit, unsigned char acc)
+ {
+   unsigned int key;
+   int node, i;
+
+   if ((numNodes + region->numReads + 1 > NODES / 4 * 3) || (poolSize + region->numWrites > WRITES))
+    {
+      ++generation;
+      numNodes = 0;
+      poolSize = 0;
+    }
+
+   key = ROOT(region->entry, region->acc);
+   for (i = 0; i < region->numReads; ++i)
+    {
+      node = find(key, 1);
+      if (FRESH == nodes[node].cell) nodes[node].cell = region->readCells[i];
+      else if (region->readCells[i] != nodes[node].cell) return; // A result: another region that ended here.
+      key = CHILD(node, region->readValues[i]);
+    }
+
+   node = find(key, 1);
+   if (FRESH != nodes[node].cell) return; // Already known, or a region that went on from here.
+   nodes[node].cell = RESULT;
+   nodes[node].exit = exit;
+   nodes[node].acc = acc;
+   nodes[node].writes = poolSize;
+   nodes[node].numWrites = region->numWrites;
+   for (i = 0; i < region->numWrites; ++i)
+    {
+      poolCells[poolSize] = region->writeCells[i];
+      poolValues[poolSize] = rwd[region->writeCells[i]];
+      ++poolSize;
+    }
+ }
+
+   // A b got to target: end every region from the innermost out to the one that ends there, if any.
+void finish (const unsigned char * rwd, int target, unsigned char acc)
+ {
+   int i, j;
+
+   for (i = depth - 1; (i >= 0) && (target != regions[i].exit); --i) ;
+   if (i < 0) return;
+   for (j = depth - 1; j >= i; --j)
+    {
+      save(rwd, regions + j, target, acc);
+    }
+   depth = i;
+ }
+
+   // A call to entry: if it has been made before with what's in MEM and ACC now, do what it did and
+   // return where it ended. Otherwise, return -1.
+int replay (unsigned char * rwd, int entry, unsigned char * acc)
+ {
+   unsigned char cells [MEM];
+   unsigned int key;
+   int node, numCells, i;
+
+   numCells = 0;
+   key = ROOT(entry, *acc);
+   for (;;)
+    {
+      node = find(key, 0);
+      if (-1 == node) return -1;
+      if (RESULT == nodes[node].cell) break;
+      cells[numCells++] = nodes[node].cell;
+      key = CHILD(node, rwd[nodes[node].cell]);
+    }
+
+      // For the regions around this one, it read and wrote what it did when it ran.
+   for (i = 0; i < numCells; ++i)
+    {
+      load(rwd, cells[i]);
+    }
+   for (i = 0; i < nodes[node].numWrites; ++i)
+    {
+      store(rwd, poolCells[nodes[node].writes + i], poolValues[nodes[node].writes + i]);
+    }
+   *acc = nodes[node].acc;
+   return nodes[node].exit;
+ }
+
+   // Start recording a call.
+void call (int entry, int exit, unsigned char acc)
+ {
+   struct region * region;
+
+   if (MAX_DEPTH == depth) return;
+   if (~0u == now)
+    {
+         // The clock ran out: start it over, with nothing being recorded.
+      depth = 0;
+      now = 0;
+      memset(touched, 0, sizeof(touched));
+      memset(written, 0, sizeof(written));
+    }
+   region = regions + depth++;
+   region->entry = entry;
+   region->exit = exit;
+   region->acc = acc;
+   region->start = ++now;
+   region->numReads = 0;
+   region->numWrites = 0;
+ }
+
+   // A taken B or b from pc. Returns where to go, which isn't target if the call was skipped.
+int jump (unsigned char * rwd, int pc, int target, unsigned char * acc, int indirect)
+ {
+   int exit;
+
+   if (indirect)
+    {
+      returnPoint[target] = 1;
+      if (0 != depth) finish(rwd, target, *acc);
+    }
+   if (returnPoint[pc + 1])
+    {
+      exit = replay(rwd, target, acc);
+      if (-1 != exit) return exit;
+      call(target, pc + 1, *acc);
+    }
+   return target;
+ }
+
+void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
+ {
+   int input, cur, pc;
+
+   input = fgetc(source);
+   cur = 0;
+
+   while (EOF != input)
+    {
+      roi[cur] = input;
+      rod[cur] = 0;
+
+      input = fgetc(source);
+
+      while ((input >= '0') && (input <= '9'))
+       {
+         rod[cur] = rod[cur] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+
+//printf("loaded instruction %c%d\n", roi[cur], rod[cur]);
+      ++cur;
+      if (MEM == cur)
+       {
+         printf("error, program too big\n");
+         exit(4);
+       }
+    }
+
+   for (pc = cur; pc < MEM; ++pc)
+    {
+      roi[pc] = 'D'; // Pseudo-instruction "done"
+      rod[pc] = 0;
+    }
+ }
+
+int main (int argc, char ** argv)
+ {
+   unsigned char roi [MEM], rod [MEM], rwd[MEM], acc;
+   int pc, cell;
+   FILE * infile;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      rwd[pc] = 0;
+    }
+
+   if (2 != argc)
+    {
+      printf("usage: GORBIT-ROM source_file\n");
+      return 2;
+    }
+   if (!imageLoad(argv[1], "ROM", roi, rod, NULL, NULL))
+    {
+      infile = fopen(argv[1], "r");
+      if (NULL == infile)
+       {
+         printf("cannot open input file\n");
+         return 3;
+       }
+      loadToMem(roi, rod, infile);
+      fclose(infile);
+      imageSave(roi, rod, NULL, 0);
+    }
+   ioInit();
+
+   pc = 0;
+   acc = 0;
+
+      // I/O throws away every region being recorded, as none of them can be skipped.
+   while (pc < MEM - 1)
+    {
+      switch (roi[pc])
+       {
+      case 'G':
+         acc = load(rwd, rod[pc]);
+         break;
+      case 'O':
+         store(rwd, rod[pc], acc);
+         break;
+      case 'R':
+         depth = 0;
+         acc = ioGet();
+         break;
+      case 'B':
+         if (0 == acc) pc = jump(rwd, pc, rod[pc], &acc, 0) - 1;
+         break;
+      case 'I':
+         acc += rod[pc];
+         break;
+      case 'T':
+         depth = 0;
+         ioPut(acc);
+         break;
+      case 'S':
+         acc = rod[pc];
+         break;
+      case 'A':
+         acc += load(rwd, rod[pc]);
+         break;
+      case 'g':
+         acc = load(rwd, load(rwd, rod[pc]));
+         break;
+      case 'o':
+         store(rwd, load(rwd, rod[pc]), acc);
+         break;
+      case 'r':
+         depth = 0;
+         store(rwd, rod[pc], ioGet());
+         break;
+      case 'b':
+         if (0 == acc) pc = jump(rwd, pc, load(rwd, rod[pc]), &acc, 1) - 1;
+         break;
+      case 'i':
+         cell = rod[pc];
+         store(rwd, cell, load(rwd, cell) + acc);
+         break;
+      case 't':
+         depth = 0;
+         ioPut(rwd[rod[pc]]);
+         break;
+      case 's':
+         acc ^= load(rwd, rod[pc]);
+         break;
+      case 'a':
+         acc += load(rwd, load(rwd, rod[pc]));
+         break;
+      case 'D':
+         pc = MEM;
+         break;
+      default:
+         ioFlush();
+         printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, roi[pc], rod[pc]);
+         pc = MEM;
+         break;
+       }
+
+      ++pc;
+    }
+
+   return 0;
+ }
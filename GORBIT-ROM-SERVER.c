@@ -0,0 +1,413 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   A server that runs one program for every connection, all of them on one thread.
+
+   usage: GORBIT-ROM-SERVER [-s slice] source_file socket_path
+
+   It listens on a Unix socket. Each connection gets its own machine (see gorbitsa.h) running the
+   program: what the client sends is the program's input, the end of it (shutdown, or close) is EOF,
+   and the program's output is sent back. When the program halts, or traps (the message is sent
+   too), the connection is closed. If the client hangs up first, the machine is thrown away.
+
+   GORBIT-ROM-2 returns out of its chain of calls every 1024 instructions, but only to call right
+   back in. Here, that is a scheduler. A machine runs for a slice of instructions (10000, by default)
+   and goes to the back of the line. One that wants input that hasn't come is set aside until epoll
+   says there is some, and then goes to the front of the line, as it has been waiting: a program
+   talking to someone gets to answer right away, while the ones that are just computing share what is
+   left. One whose output can't be sent yet waits for epoll to say it can.
+
+   Nothing here ever blocks but epoll_wait, and that only when there is nothing to run.
+*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "gorbitsa.h"
+
+#define SLICE 10000
+#define MAX_EVENTS 256
+#define BUFFER 4096
+#define PENDING 512  // The machine's output, and room for the illegal instruction message.
+
+   // What a client is waiting on.
+#define READY   0  // A turn to run: it's in the line.
+#define READING 1  // Input.
+#define WRITING 2  // Room to send its output.
+#define GONE    3  // Nothing: its client hung up, and it gets dropped when its turn comes.
+
+struct client
+ {
+   struct gorbitsa vm;
+   int fd, state, status;
+   struct client * next;                    // In the line.
+   unsigned char input [BUFFER];
+   unsigned char pending [PENDING];         // Output not sent yet.
+   size_t sent, pendingSize;
+ };
+
+   // The line of machines that can run.
+struct line
+ {
+   struct client * head, * tail;
+ };
+
+static struct line line;
+static struct gorbitsa program;
+static int epoll;
+
+void pushBack (struct client * client)
+ {
+   client->state = READY;
+   client->next = NULL;
+   if (NULL == line.tail)
+    {
+      line.head = client;
+    }
+   else
+    {
+      line.tail->next = client;
+    }
+   line.tail = client;
+ }
+
+void pushFront (struct client * client)
+ {
+   client->state = READY;
+   client->next = line.head;
+   line.head = client;
+   if (NULL == line.tail)
+    {
+      line.tail = client;
+    }
+ }
+
+struct client * pop (void)
+ {
+   struct client * client;
+
+   client = line.head;
+   line.head = client->next;
+   if (NULL == line.head)
+    {
+      line.tail = NULL;
+    }
+   return client;
+ }
+
+   // Wait on the client's socket for events (or nothing).
+void watch (struct client * client, int state, unsigned int events)
+ {
+   struct epoll_event event;
+
+   client->state = state;
+   event.events = events;
+   event.data.ptr = client;
+   epoll_ctl(epoll, EPOLL_CTL_MOD, client->fd, &event);
+ }
+
+void finish (struct client * client)
+ {
+   close(client->fd); // Which also takes it out of epoll.
+   free(client);
+ }
+
+   // Send what we can of the pending output. Returns 0 if the client is gone.
+int sendOutput (struct client * client)
+ {
+   ssize_t wrote;
+
+   while (client->sent < client->pendingSize)
+    {
+      wrote = write(client->fd, client->pending + client->sent, client->pendingSize - client->sent);
+      if (wrote > 0)
+       {
+         client->sent += wrote;
+       }
+      else if ((wrote < 0) && (EINTR == errno))
+       {
+         continue;
+       }
+      else if ((wrote < 0) && ((EAGAIN == errno) || (EWOULDBLOCK == errno)))
+       {
+         return 1;
+       }
+      else
+       {
+         return 0;
+       }
+    }
+   client->sent = 0;
+   client->pendingSize = 0;
+   return 1;
+ }
+
+   // Now that its output is sent, what the client does next depends on why the machine stopped.
+void next (struct client * client)
+ {
+   switch (client->status)
+    {
+   case GORBITSA_BUDGET:
+   case GORBITSA_OUTPUT:
+      watch(client, READY, 0);
+      pushBack(client);
+      break;
+   case GORBITSA_INPUT:
+      watch(client, READING, EPOLLIN);
+      break;
+   default:
+      finish(client);
+      break;
+    }
+ }
+
+   // Give the client its turn.
+void run (struct client * client, unsigned long long slice)
+ {
+   struct gorbitsa * vm = &client->vm;
+
+   client->status = gorbitsaRun(vm, slice);
+
+   memcpy(client->pending, vm->output, vm->outputSize);
+   client->pendingSize = vm->outputSize;
+   vm->outputSize = 0;
+   if (GORBITSA_TRAP == client->status)
+    {
+      client->pendingSize += snprintf((char *) client->pending + client->pendingSize, PENDING - client->pendingSize,
+         "Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d",
+         vm->pc, vm->acc, vm->roi[vm->pc], vm->rod[vm->pc]);
+    }
+
+   if (!sendOutput(client))
+    {
+      finish(client);
+    }
+   else if (0 != client->pendingSize)
+    {
+      watch(client, WRITING, EPOLLOUT);
+    }
+   else
+    {
+      next(client);
+    }
+ }
+
+   // Its input came, or there won't be any more.
+void readInput (struct client * client)
+ {
+   ssize_t got;
+
+   got = recv(client->fd, client->input, BUFFER, 0);
+   if ((got < 0) && ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (EINTR == errno)))
+    {
+      return;
+    }
+   if (got > 0)
+    {
+      gorbitsaInput(&client->vm, client->input, got);
+    }
+   else
+    {
+      gorbitsaEndInput(&client->vm);
+    }
+   watch(client, READY, 0);
+   pushFront(client);
+ }
+
+void acceptClients (int listener)
+ {
+   struct client * client;
+   struct epoll_event event;
+   int fd;
+
+   while (-1 != (fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)))
+    {
+      client = malloc(sizeof(struct client));
+      if (NULL == client)
+       {
+         close(fd);
+         continue;
+       }
+      client->vm = program;
+      client->fd = fd;
+      client->sent = 0;
+      client->pendingSize = 0;
+
+      event.events = 0;
+      event.data.ptr = client;
+      if (0 != epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event))
+       {
+         finish(client);
+         continue;
+       }
+      pushBack(client);
+    }
+ }
+
+int main (int argc, char ** argv)
+ {
+   struct epoll_event events [MAX_EVENTS];
+   struct epoll_event event;
+   struct sockaddr_un address;
+   struct client * client;
+   unsigned long long slice;
+   char * text;
+   long size;
+   int opt, listener, count, i;
+   FILE * infile;
+
+   slice = SLICE;
+   while (-1 != (opt = getopt(argc, argv, "s:")))
+    {
+      switch (opt)
+       {
+      case 's':
+         slice = strtoull(optarg, NULL, 10);
+         break;
+      default:
+         printf("usage: GORBIT-ROM-SERVER [-s slice] source_file socket_path\n");
+         return 2;
+       }
+    }
+   if ((argc - optind != 2) || (0 == slice))
+    {
+      printf("usage: GORBIT-ROM-SERVER [-s slice] source_file socket_path\n");
+      return 2;
+    }
+
+   infile = fopen(argv[optind], "r");
+   if (NULL == infile)
+    {
+      printf("cannot open input file\n");
+      return 3;
+    }
+   fseek(infile, 0, SEEK_END);
+   size = ftell(infile);
+   rewind(infile);
+   text = (size < 0) ? NULL : malloc(size + 1);
+   if ((NULL == text) || ((size_t) size != fread(text, 1, size, infile)))
+    {
+      printf("cannot read input file\n");
+      return 3;
+    }
+   fclose(infile);
+   if (!gorbitsaLoad(&program, text, size))
+    {
+      printf("error, program too big\n");
+      return 4;
+    }
+   free(text);
+
+   memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   if (strlen(argv[optind + 1]) >= sizeof(address.sun_path))
+    {
+      printf("socket path too long\n");
+      return 2;
+    }
+   strcpy(address.sun_path, argv[optind + 1]);
+   unlink(address.sun_path);
+
+   signal(SIGPIPE, SIG_IGN); // A client that goes away is just a failed write.
+   listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+   epoll = epoll_create1(EPOLL_CLOEXEC);
+   if ((listener < 0) || (epoll < 0) || (0 != bind(listener, (struct sockaddr *) &address, sizeof(address))) ||
+      (0 != listen(listener, SOMAXCONN)))
+    {
+      printf("cannot listen on %s\n", address.sun_path);
+      return 3;
+    }
+   event.events = EPOLLIN;
+   event.data.ptr = NULL;
+   epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+
+   for (;;)
+    {
+         // Only sleep if there's nothing to run. Otherwise, look, and then run the next in line.
+      count = epoll_wait(epoll, events, MAX_EVENTS, (NULL == line.head) ? -1 : 0);
+      for (i = 0; i < count; ++i)
+       {
+         client = events[i].data.ptr;
+         if (NULL == client)
+          {
+            acceptClients(listener);
+          }
+         else if (events[i].events & (EPOLLHUP | EPOLLERR))
+          {
+            if (READY == client->state)
+             {
+               client->state = GONE;
+             }
+            else if (GONE != client->state)
+             {
+               finish(client);
+             }
+          }
+         else if (READING == client->state)
+          {
+            readInput(client);
+          }
+         else if (WRITING == client->state)
+          {
+            if (!sendOutput(client))
+             {
+               finish(client);
+             }
+            else if (0 == client->pendingSize)
+             {
+               next(client);
+             }
+          }
+       }
+
+      if (NULL != line.head)
+       {
+         client = pop();
+         if (GONE == client->state)
+          {
+            finish(client);
+          }
+         else
+          {
+            run(client, slice);
+          }
+       }
+    }
+
+   return 0;
+ }
@@ -0,0 +1,529 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   Lockstep: run LANES instances of one ROM program at once, in the lanes of vector registers.
+
+   usage: GORBIT-ROM-SIMD [-n count | -r] source_file [input_file ...]
+
+   The jobs are the same as GORBIT-ROM-BATCH's (see GORBIT-JOB.h): each input file is one (with its
+   output going to input_file.out), or with -r each line of them is one (with the outputs printed in
+   order, one line each). -n runs the program count times with no input, and prints the outputs
+   like -r.
+
+   The state of all of the lanes is kept as structure-of-arrays: MEM is 256 vectors, one per cell,
+   with a lane in each for every instance, and ACC and the PCs are vectors. A cell is 32 bits wide,
+   and wraps by masking, so that a vector of them is exactly what the gather and scatter
+   instructions work on: 16 lanes is one AVX-512 register per cell.
+
+   Each step picks the lowest PC of any running lane, and executes that instruction for the lanes
+   that are at it, under a mask. When every instance takes the same path, every lane is at the
+   same PC, and each step does the work of 16 instructions. When they diverge at a B or b, the
+   lanes that are behind run alone until they catch up with the others, which (for the usual loops
+   and subroutines) they do at the next join. Taking the lowest PC is what makes them meet there.
+
+   Direct accesses are whole vectors: "G5" loads the vector for cell 5. The indirect accesses
+   (g, o, a) are a gather or scatter, each lane at its own address in its own column of MEM.
+   I/O is done a lane at a time, into the job's buffers, as is an illegal instruction, which ends
+   that lane's job. A lane whose job is done takes the next job, if there is one.
+
+   With AVX-512 (or AVX2, for the gathers) the Makefile builds this with -march=native, and the
+   gathers and scatters are the real instructions. Otherwise, GCC's vector extensions do the
+   rest, and the indirect accesses go a lane at a time.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "GORBIT-JOB.h"
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/*
+G     ACC = MEM[IMM]
+O     MEM[IMM] = ACC
+R     ACC = INPUT
+B     BRZ IMM
+I     ACC += IMM
+T     PRINT ACC
+S     ACC = IMM
+A     ACC += MEM[IMM]
+
+g     ACC = MEM[MEM[IMM]]
+o     MEM[MEM[IMM]] = ACC
+r     MEM[IMM] = INPUT
+b     BRZ MEM[IMM]
+i     MEM[IMM] += ACC
+t     PRINT MEM[IMM]
+s     ACC ^= MEM[IMM]
+a     ACC += MEM[MEM[IMM]]
+
+Translation:
+   ACC      acc (a lane of it)
+   IMM      rod[pc]
+   MEM      mem (a lane of every cell)
+*/
+
+#define MEM 256
+#define LANES 16
+
+typedef unsigned int lanes __attribute__ ((vector_size (LANES * sizeof(unsigned int))));
+
+struct machine
+ {
+   lanes mem [MEM];
+   struct job * job [LANES];
+ };
+
+static const lanes laneIndex = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+   // The lowest PC of the running lanes.
+   // (The vectors are passed by pointer, to keep them out of the calling convention.)
+unsigned int lowestPc(const lanes * pc, const lanes * running)
+ {
+#if defined(__AVX512F__)
+   return _mm512_mask_reduce_min_epu32(_mm512_test_epi32_mask((__m512i) *running, (__m512i) *running), (__m512i) *pc);
+#else
+   unsigned int result;
+   int lane;
+
+   result = MEM;
+   for (lane = 0; lane < LANES; ++lane)
+    {
+      if ((*running)[lane] && ((*pc)[lane] < result)) result = (*pc)[lane];
+    }
+   return result;
+#endif
+ }
+
+   // Whether every lane of v is zero.
+int none(const lanes * v)
+ {
+#if defined(__AVX512F__)
+   return 0 == _mm512_test_epi32_mask((__m512i) *v, (__m512i) *v);
+#elif defined(__AVX2__)
+   const __m256i * half = (const __m256i *) v;
+
+   return _mm256_testz_si256(half[0] | half[1], half[0] | half[1]);
+#else
+   int lane;
+
+   for (lane = 0; lane < LANES; ++lane)
+    {
+      if ((*v)[lane]) return 0;
+    }
+   return 1;
+#endif
+ }
+
+   // Whether every lane in mask has the same address as the first. Such an access is a whole
+   // vector, like a direct one: which is faster than a gather, and a lot faster than a scatter
+   // that a later load of the cell can't be forwarded from.
+int uniform(const lanes * address, const lanes * mask)
+ {
+   lanes differ = (*address != (*address)[0]) & *mask;
+
+   return none(&differ);
+ }
+
+   // In each lane in mask, into = MEM[address].
+void gather(const struct machine * m, const lanes * address, const lanes * mask, lanes * into)
+ {
+   lanes index = *address * LANES + laneIndex;
+
+   if (uniform(address, mask))
+    {
+      *into = (m->mem[(*address)[0]] & *mask) | (*into & ~*mask);
+      return;
+    }
+#if defined(__AVX512F__)
+   *into = (lanes) _mm512_mask_i32gather_epi32((__m512i) *into, _mm512_test_epi32_mask((__m512i) *mask, (__m512i) *mask),
+      (__m512i) index, m->mem, sizeof(unsigned int));
+#elif defined(__AVX2__)
+   const __m256i * halfIndex = (const __m256i *) &index;
+   const __m256i * halfMask = (const __m256i *) mask;
+   __m256i * half = (__m256i *) into;
+
+   half[0] = _mm256_mask_i32gather_epi32(half[0], (const int *) m->mem, halfIndex[0], halfMask[0], sizeof(unsigned int));
+   half[1] = _mm256_mask_i32gather_epi32(half[1], (const int *) m->mem, halfIndex[1], halfMask[1], sizeof(unsigned int));
+#else
+   const unsigned int * cells = (const unsigned int *) m->mem;
+   int lane;
+
+   for (lane = 0; lane < LANES; ++lane)
+    {
+      if ((*mask)[lane]) (*into)[lane] = cells[index[lane]];
+    }
+#endif
+ }
+
+   // In each lane in mask, MEM[address] = value.
+void scatter(struct machine * m, const lanes * address, const lanes * mask, const lanes * value)
+ {
+   lanes index = *address * LANES + laneIndex;
+
+   if (uniform(address, mask))
+    {
+      m->mem[(*address)[0]] = (*value & *mask) | (m->mem[(*address)[0]] & ~*mask);
+      return;
+    }
+#if defined(__AVX512F__)
+   _mm512_mask_i32scatter_epi32(m->mem, _mm512_test_epi32_mask((__m512i) *mask, (__m512i) *mask),
+      (__m512i) index, (__m512i) *value, sizeof(unsigned int));
+#else
+   unsigned int * cells = (unsigned int *) m->mem;
+   int lane;
+
+   for (lane = 0; lane < LANES; ++lane)
+    {
+      if ((*mask)[lane]) cells[index[lane]] = (*value)[lane];
+    }
+#endif
+ }
+
+   // Give a lane the next job that can run, and clear its memory. Returns whether there was one.
+int start(struct machine * m, int lane, struct job * jobs, int numJobs, int * started)
+ {
+   int cell;
+
+   while ((*started < numJobs) && (JOB_IO == jobs[*started].status))
+    {
+      ++*started;
+    }
+   if (*started == numJobs)
+    {
+      return 0;
+    }
+
+   for (cell = 0; cell < MEM; ++cell)
+    {
+      m->mem[cell][lane] = 0;
+    }
+   m->job[lane] = &jobs[(*started)++];
+   return 1;
+ }
+
+   // Run every job, LANES at a time.
+void run(const unsigned char * roi, const unsigned char * rod, struct job * jobs, int numJobs)
+ {
+   static struct machine m;
+   lanes acc, at, live, mask, zero, done, select, value;
+   unsigned int pc, imm;
+   int lane, started, running, jumped;
+
+      // acc and at are every lane's ACC and PC, and live is all ones in the lanes that have a job.
+      // The code that goes a lane at a time works on copies (select, value): indexing a vector
+      // with a variable keeps it in memory, and these should stay in registers.
+      // Every lane starts out finished, at the end of memory, so that the first pass takes jobs.
+   memset(&m, 0, sizeof(m));
+   acc = (lanes) { 0 };
+   at = acc + (MEM - 1);
+   live = acc - 1;
+   mask = acc;
+   started = 0;
+   running = LANES;
+
+   pc = 0;
+   jumped = 1;
+   while (0 != running)
+    {
+         // The lanes in mask are the ones at pc. Their entries in at aren't kept up to date until
+         // there is a jump, after which the lanes can be anywhere: the ones that got to the end of
+         // memory are done (and take the next job, or stop), and the lowest PC is found again.
+      if (jumped)
+       {
+         done = live & (at == (MEM - 1));
+         if (!none(&done))
+          {
+            acc &= ~done;
+            at &= ~done;
+            select = done;
+            for (lane = 0; lane < LANES; ++lane)
+             {
+               if (select[lane] && start(&m, lane, jobs, numJobs, &started))
+                {
+                  select[lane] = 0;
+                }
+               else if (select[lane])
+                {
+                  --running;
+                }
+             }
+            live &= ~select;
+          }
+         if (0 == running)
+          {
+            break;
+          }
+         pc = lowestPc(&at, &live);
+         mask = (at == pc) & live;
+         jumped = 0;
+       }
+
+      imm = rod[pc];
+
+      switch (roi[pc])
+       {
+      case 'G':
+         acc = (m.mem[imm] & mask) | (acc & ~mask);
+         break;
+      case 'O':
+         m.mem[imm] = (acc & mask) | (m.mem[imm] & ~mask);
+         break;
+      case 'R':
+         select = mask;
+         value = acc;
+         for (lane = 0; lane < LANES; ++lane)
+          {
+            if (select[lane]) value[lane] = jobGet(m.job[lane]) & 0xFF;
+          }
+         acc = value;
+         break;
+      case 'B':
+         zero = mask & (acc == 0);
+         at = ((pc + 1) & mask) | (at & ~mask);
+         at = (imm & zero) | (at & ~zero);
+         jumped = 1;
+         break;
+      case 'I':
+         acc = (((acc + imm) & 0xFF) & mask) | (acc & ~mask);
+         break;
+      case 'T':
+         select = mask;
+         value = acc;
+         for (lane = 0; lane < LANES; ++lane)
+          {
+            if (select[lane]) jobPut(m.job[lane], value[lane]);
+          }
+         break;
+      case 'S':
+         acc = (imm & mask) | (acc & ~mask);
+         break;
+      case 'A':
+         acc = (((acc + m.mem[imm]) & 0xFF) & mask) | (acc & ~mask);
+         break;
+      case 'g':
+         gather(&m, &m.mem[imm], &mask, &acc);
+         break;
+      case 'o':
+         scatter(&m, &m.mem[imm], &mask, &acc);
+         break;
+      case 'r':
+         select = mask;
+         for (lane = 0; lane < LANES; ++lane)
+          {
+            if (select[lane]) m.mem[imm][lane] = jobGet(m.job[lane]) & 0xFF;
+          }
+         break;
+      case 'b':
+         zero = mask & (acc == 0);
+         at = ((pc + 1) & mask) | (at & ~mask);
+         at = (m.mem[imm] & zero) | (at & ~zero);
+         jumped = 1;
+         break;
+      case 'i':
+         m.mem[imm] = (((m.mem[imm] + acc) & 0xFF) & mask) | (m.mem[imm] & ~mask);
+         break;
+      case 't':
+         select = mask;
+         for (lane = 0; lane < LANES; ++lane)
+          {
+            if (select[lane]) jobPut(m.job[lane], m.mem[imm][lane]);
+          }
+         break;
+      case 's':
+         acc = ((acc ^ m.mem[imm]) & mask) | (acc & ~mask);
+         break;
+      case 'a':
+         value = acc;
+         gather(&m, &m.mem[imm], &mask, &value);
+         acc = (((acc + value) & 0xFF) & mask) | (acc & ~mask);
+         break;
+      case 'D':
+         at = ((MEM - 1) & mask) | (at & ~mask);
+         jumped = 1;
+         break;
+      default:
+         select = mask;
+         value = acc;
+         for (lane = 0; lane < LANES; ++lane)
+          {
+            if (select[lane]) jobIllegal(m.job[lane], pc, value[lane], roi[pc], imm);
+          }
+         at = ((MEM - 1) & mask) | (at & ~mask);
+         jumped = 1;
+         break;
+       }
+
+         // Otherwise, the lanes in mask are all at the next instruction, and every other lane was
+         // already past it, so that is the lowest PC. A jump has already put its lanes in at: a
+         // B at 254 that is taken goes to its target, not to the end of memory.
+      ++pc;
+      if (!jumped && (MEM - 1 == pc))
+       {
+         at = (pc & mask) | (at & ~mask);
+         jumped = 1;
+       }
+      mask |= (at == pc) & live;
+    }
+ }
+
+void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
+ {
+   int input, cur, pc;
+
+   input = fgetc(source);
+   cur = 0;
+
+   while (EOF != input)
+    {
+      roi[cur] = input;
+      rod[cur] = 0;
+
+      input = fgetc(source);
+
+      while ((input >= '0') && (input <= '9'))
+       {
+         rod[cur] = rod[cur] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+
+//printf("loaded instruction %c%d\n", roi[cur], rod[cur]);
+      ++cur;
+      if (MEM == cur)
+       {
+         printf("error, program too big\n");
+         exit(4);
+       }
+    }
+
+   for (pc = cur; pc < MEM; ++pc)
+    {
+      roi[pc] = 'D'; // Pseudo-instruction "done"
+      rod[pc] = 0;
+    }
+ }
+
+int main (int argc, char ** argv)
+ {
+   unsigned char roi [MEM], rod [MEM];
+   struct job * jobs;
+   FILE * infile;
+   int pc, opt, count, records, status, numJobs, i;
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      roi[pc] = 0;
+      rod[pc] = 0;
+    }
+
+   count = 0;
+   records = 0;
+   while (-1 != (opt = getopt(argc, argv, "n:r")))
+    {
+      switch (opt)
+       {
+      case 'n':
+         count = atoi(optarg);
+         break;
+      case 'r':
+         records = 1;
+         break;
+      default:
+         printf("usage: GORBIT-ROM-SIMD [-n count | -r] source_file [input_file ...]\n");
+         return 2;
+       }
+    }
+   if (optind >= argc)
+    {
+      printf("usage: GORBIT-ROM-SIMD [-n count | -r] source_file [input_file ...]\n");
+      return 2;
+    }
+
+   infile = fopen(argv[optind], "r");
+   if (NULL == infile)
+    {
+      printf("cannot open input file\n");
+      return 3;
+    }
+   loadToMem(roi, rod, infile);
+   fclose(infile);
+   ++optind;
+
+   status = JOB_OK;
+   if (records)
+    {
+      jobs = jobReadRecords(argv + optind, argc - optind, &numJobs, &status);
+    }
+   else
+    {
+      numJobs = (0 != count) ? count : (argc - optind);
+      jobs = calloc(numJobs + 1, sizeof(struct job));
+      if (NULL == jobs)
+       {
+         printf("out of memory\n");
+         return 5;
+       }
+      for (i = 0; (0 == count) && (i < numJobs); ++i)
+       {
+         jobs[i].name = argv[optind + i];
+         jobs[i].input = jobReadFile(jobs[i].name, &jobs[i].inputSize);
+         if (NULL == jobs[i].input)
+          {
+            fprintf(stderr, "cannot open input file %s\n", jobs[i].name);
+            jobs[i].status = JOB_IO;
+          }
+       }
+    }
+
+   run(roi, rod, jobs, numJobs);
+
+   for (i = 0; i < numJobs; ++i)
+    {
+      if (NULL == jobs[i].name)
+       {
+         fwrite(jobs[i].output, 1, jobs[i].outputSize, stdout);
+         putchar('\n');
+       }
+      else if (JOB_IO != jobs[i].status)
+       {
+         jobWriteOutput(&jobs[i]);
+       }
+      if (jobs[i].status > status) status = jobs[i].status;
+    }
+
+   return status;
+ }
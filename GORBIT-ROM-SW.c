@@ -68,6 +68,7 @@ SUCH DAMAGE.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "GORBIT-IO.h"
 
 /*
 G     ACC = MEM[IMM]
@@ -98,7 +99,7 @@ Translation:
 
 void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
  {
-   int input, cur;
+   int input, cur, pc;
 
    input = fgetc(source);
    cur = 0;
@@ -130,9 +131,10 @@ void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
        }
     }
 
-   if (MEM != cur)
+   for (pc = cur; pc < MEM; ++pc)
     {
-      roi[cur] = 'D'; // Pseudo-instruction "done"
+      roi[pc] = 'D'; // Pseudo-instruction "done"
+      rod[pc] = 0;
     }
  }
 
@@ -160,6 +162,7 @@ int main (int argc, char ** argv)
     }
    loadToMem(roi, rod, infile);
    fclose(infile);
+   ioInit();
 
    pc = 0;
    acc = 0;
@@ -175,7 +178,7 @@ int main (int argc, char ** argv)
          rwd[rod[pc]] = acc;
          break;
       case 'R':
-         acc = getchar();
+         acc = ioGet();
          break;
       case 'B':
          if (0 == acc) pc = rod[pc] - 1;
@@ -184,7 +187,7 @@ int main (int argc, char ** argv)
          acc += rod[pc];
          break;
       case 'T':
-         putchar(acc);
+         ioPut(acc);
          break;
       case 'S':
          acc = rod[pc];
@@ -199,7 +202,7 @@ int main (int argc, char ** argv)
          rwd[rwd[rod[pc]]] = acc;
          break;
       case 'r':
-         rwd[rod[pc]] = getchar();
+         rwd[rod[pc]] = ioGet();
          break;
       case 'b':
          if (0 == acc) pc = rwd[rod[pc]] - 1;
@@ -208,7 +211,7 @@ int main (int argc, char ** argv)
          rwd[rod[pc]] += acc;
          break;
       case 't':
-         putchar(rwd[rod[pc]]);
+         ioPut(rwd[rod[pc]]);
          break;
       case 's':
          acc ^= rwd[rod[pc]];
@@ -220,6 +223,7 @@ int main (int argc, char ** argv)
          pc = MEM;
          break;
       default:
+         ioFlush();
          printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, roi[pc], rod[pc]);
          pc = MEM;
          break;
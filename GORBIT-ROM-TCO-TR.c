@@ -66,10 +66,28 @@ SUCH DAMAGE.
 
    The thing that you can fault me on is that this program is not good for learning, and it is not good for
    debugging. It's about having an "OMG FAST!!!1" interpreter, without resorting to complicated optimizations.
+
+   This is the TCO engine, tracing every instruction it executes.
+
+   usage: GORBIT-ROM-TCO-TR source_file [trace_file]
+
+   The trace (trace.bin, by default) is binary: the program, then a five byte record per instruction.
+   GORBIT-TRACE turns it into text, one line per instruction, with the program's output where it
+   happened. Formatting that for every instruction took far longer than the instruction did, so now
+   the engine only stores the record in a ring buffer, and a second thread writes the buffer to the
+   file. The engine publishes what it has written a chunk at a time, and only waits if the buffer is
+   full. There are no locks: each side has a count of records that only it writes.
 */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "GORBIT-IO.h"
+#include "GORBIT-TAIL.h"
 
 /*
 G     ACC = MEM[IMM]
@@ -98,155 +116,184 @@ Translation:
 
 #define MEM 256
 
+   // A trace record: the instruction, ACC after it, and what it worked on. The address and value are
+   // the cell and its value for the instructions that use one (for g, o, and a, the cell that MEM[IMM]
+   // points to), the next PC for B and b, the character for R, T, and t, and IMM for an illegal
+   // instruction. GORBIT-TRACE reads these.
+struct record
+ {
+   unsigned char pc, op, acc, address, value;
+ };
+
+#define TRACE_MAGIC "GORBITTR"
+#define TRACE_RECORDS (1 << 20) // The ring buffer; a power of two.
+#define TRACE_CHUNK 4096        // How many records the engine writes before publishing them.
+
+static struct record trace [TRACE_RECORDS];
+static size_t traceHead, traceLimit;   // The engine's: the next record, and where to stop and publish.
+static atomic_size_t tracePublished, traceDrained;
+static atomic_int traceDone;
+static int traceFailed;
+static FILE * traceFile;
+static pthread_t traceThread;
+
+void traceWait (void);
+
+#define TRACE(op, address, value) \
+   if (traceHead == traceLimit) traceWait(); \
+   trace[traceHead & (TRACE_RECORDS - 1)] = (struct record) { pc, op, acc, address, value }; \
+   ++traceHead
+
 #define DISPATCH \
    ++pc; \
-   if (pc == (MEM - 1)) return; \
-   operations[roi[pc]](roi, rod, rwd, pc, acc);
+   TAIL_CALL operations[roi[pc]](roi, rod, rwd, pc, acc);
 
-extern void (*operations[])(unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc);
+extern void (TAIL_CC * operations[])(unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc);
 
-void G (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void G (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc = rwd[rod[pc]];
-printf("%03d Executed G: Acc (%d) Imm (%d)\n", pc, acc, rod[pc]);
+   TRACE('G', rod[pc], acc);
 
    DISPATCH
  }
 
-void O (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void O (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    rwd[rod[pc]] = acc;
-printf("%03d Executed O: Acc (%d) Imm (%d)\n", pc, acc, rod[pc]);
+   TRACE('O', rod[pc], acc);
 
    DISPATCH
  }
 
-void R (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void R (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
-   acc = getchar();
-printf("%03d Executed R: Acc (%d)\n", pc, acc);
+   acc = ioGet();
+   TRACE('R', 0, acc);
 
    DISPATCH
  }
 
-void B (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void B (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
+   TRACE('B', (0 == acc) ? rod[pc] : (pc + 1), 0);
    if (0 == acc) pc = rod[pc] - 1;
-printf("--- Executed B: PC (%d)\n", pc + 1);
 
    DISPATCH
  }
 
-void I (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void I (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc += rod[pc];
-printf("%03d Executed I: Acc (%d)\n", pc, acc);
+   TRACE('I', 0, 0);
 
    DISPATCH
  }
 
-void T (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void T (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
-   putchar(acc);
-printf("\n%03d Executed T\n", pc);
+   ioPut(acc);
+   TRACE('T', 0, acc);
 
    DISPATCH
  }
 
-void S (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void S (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc = rod[pc];
-printf("%03d Executed S: Acc (%d)\n", pc, acc);
+   TRACE('S', 0, 0);
 
    DISPATCH
  }
 
-void A (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void A (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc += rwd[rod[pc]];
-printf("%03d Executed A\n", pc);
+   TRACE('A', rod[pc], rwd[rod[pc]]);
 
    DISPATCH
  }
 
-void g (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void g (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc = rwd[rwd[rod[pc]]];
-printf("%03d Executed g: Acc (%d) Imm (%d) [Imm] (%d)\n", pc, acc, rod[pc], rwd[rod[pc]]);
+   TRACE('g', rwd[rod[pc]], acc);
 
    DISPATCH
  }
 
-void o (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void o (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    rwd[rwd[rod[pc]]] = acc;
-printf("%03d Executed o: Acc (%d) Imm (%d) [Imm] (%d)\n", pc, acc, rod[pc], rwd[rod[pc]]);
+   TRACE('o', rwd[rod[pc]], acc);
 
    DISPATCH
  }
 
-void r (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void r (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
-   rwd[rod[pc]] = getchar();
-printf("%03d Executed r\n", pc);
+   rwd[rod[pc]] = ioGet();
+   TRACE('r', rod[pc], rwd[rod[pc]]);
 
    DISPATCH
  }
 
-void b (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void b (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
+   TRACE('b', (0 == acc) ? rwd[rod[pc]] : (pc + 1), 0);
    if (0 == acc) pc = rwd[rod[pc]] - 1;
-printf("--- Executed b: PC (%d)\n", pc + 1);
 
    DISPATCH
  }
 
-void i (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void i (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    rwd[rod[pc]] += acc;
-printf("%03d Executed i: Acc (%d) Imm (%d) [Imm] (%d)\n", pc, acc, rod[pc], rwd[rod[pc]]);
+   TRACE('i', rod[pc], rwd[rod[pc]]);
 
    DISPATCH
  }
 
-void t (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void t (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
-   putchar(rwd[rod[pc]]);
-printf("%03d Executed t\n", pc);
+   ioPut(rwd[rod[pc]]);
+   TRACE('t', rod[pc], rwd[rod[pc]]);
 
    DISPATCH
  }
 
-void s (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void s (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc ^= rwd[rod[pc]];
-printf("%03d Executed s\n", pc);
+   TRACE('s', rod[pc], rwd[rod[pc]]);
 
    DISPATCH
  }
 
-void a (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void a (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc += rwd[rwd[rod[pc]]];
-printf("%03d Executed a\n", pc);
+   TRACE('a', rwd[rod[pc]], rwd[rwd[rod[pc]]]);
 
    DISPATCH
  }
 
-void E (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void E (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    (void) rwd;
+   TRACE(roi[pc], rod[pc], 0);
+   ioFlush();
    printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, roi[pc], rod[pc]);
    exit(1);
  }
 
-void D(unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void D(unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    (void) roi; (void) rod; (void) rwd; (void) pc; (void) acc;
    return;
  }
 
-void (*operations[])(unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc) =
+void (TAIL_CC * operations[])(unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc) =
  {
    E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
    E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
@@ -266,9 +313,101 @@ void (*operations[])(unsigned char * roi, unsigned char * rod, unsigned char * r
    E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E
  };
 
+   // Publish the records written so far, and wait until there is room for more.
+void traceWait (void)
+ {
+   size_t drained;
+
+   atomic_store_explicit(&tracePublished, traceHead, memory_order_release);
+   while (traceHead - (drained = atomic_load_explicit(&traceDrained, memory_order_acquire)) == TRACE_RECORDS)
+    {
+      sched_yield();
+    }
+   traceLimit = drained + TRACE_RECORDS;
+   if (traceLimit - traceHead > TRACE_CHUNK)
+    {
+      traceLimit = traceHead + TRACE_CHUNK;
+    }
+ }
+
+   // The writing thread: write out whatever has been published, until the engine is done.
+void * traceDrain (void * unused)
+ {
+   const struct timespec nap = { 0, 1000000 };
+   size_t published, drained, end;
+   int done;
+
+   (void) unused;
+   drained = 0;
+   for (;;)
+    {
+      done = atomic_load_explicit(&traceDone, memory_order_acquire);
+      published = atomic_load_explicit(&tracePublished, memory_order_acquire);
+      if (published == drained)
+       {
+         if (done)
+          {
+            break;
+          }
+         nanosleep(&nap, NULL);
+         continue;
+       }
+
+      while (drained != published)
+       {
+            // Up to the end of the buffer, at most.
+         end = published;
+         if ((drained & ~(size_t) (TRACE_RECORDS - 1)) != (end & ~(size_t) (TRACE_RECORDS - 1)))
+          {
+            end = (drained | (TRACE_RECORDS - 1)) + 1;
+          }
+         if (end - drained != fwrite(&trace[drained & (TRACE_RECORDS - 1)], sizeof(struct record), end - drained, traceFile))
+          {
+            traceFailed = 1;
+          }
+         drained = end;
+         atomic_store_explicit(&traceDrained, drained, memory_order_release);
+       }
+    }
+   return NULL;
+ }
+
+void traceFinish (void)
+ {
+   atomic_store_explicit(&tracePublished, traceHead, memory_order_release);
+   atomic_store_explicit(&traceDone, 1, memory_order_release);
+   pthread_join(traceThread, NULL);
+   if ((0 != fclose(traceFile)) || traceFailed)
+    {
+      fprintf(stderr, "cannot write trace file\n");
+    }
+ }
+
+   // Open the trace, write the program at the top of it, and start the writing thread.
+int traceStart (const char * name, const unsigned char * roi, const unsigned char * rod)
+ {
+   traceFile = fopen(name, "wb");
+   if (NULL == traceFile)
+    {
+      return 0;
+    }
+   fwrite(TRACE_MAGIC, 1, strlen(TRACE_MAGIC), traceFile);
+   fwrite(roi, 1, MEM, traceFile);
+   fwrite(rod, 1, MEM, traceFile);
+
+   traceLimit = TRACE_CHUNK;
+   if (0 != pthread_create(&traceThread, NULL, traceDrain, NULL))
+    {
+      fclose(traceFile);
+      return 0;
+    }
+   atexit(traceFinish);
+   return 1;
+ }
+
 void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
  {
-   int input, cur;
+   int input, cur, pc;
 
    input = fgetc(source);
    cur = 0;
@@ -300,9 +439,12 @@ void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
        }
     }
 
-   if (MEM != cur)
+      // Everything after the program, including instruction 255, is the pseudo-instruction "done", so
+      // DISPATCH doesn't have to check for the end of memory.
+   for (pc = cur; pc < MEM; ++pc)
     {
-      roi[cur] = 'D'; // Pseudo-instruction "done"
+      roi[pc] = 'D';
+      rod[pc] = 0;
     }
  }
 
@@ -314,12 +456,14 @@ int main (int argc, char ** argv)
 
    for (pc = 0; pc < MEM; ++pc)
     {
+      roi[pc] = 0;
+      rod[pc] = 0;
       rwd[pc] = 0;
     }
 
-   if (2 != argc)
+   if ((2 != argc) && (3 != argc))
     {
-      printf("usage: GORBIT-ROM source_file\n");
+      printf("usage: GORBIT-ROM-TCO-TR source_file [trace_file]\n");
       return 2;
     }
    infile = fopen(argv[1], "r");
@@ -330,6 +474,12 @@ int main (int argc, char ** argv)
     }
    loadToMem(roi, rod, infile);
    fclose(infile);
+   ioInit();
+   if (!traceStart((3 == argc) ? argv[2] : "trace.bin", roi, rod))
+    {
+      printf("cannot open trace file\n");
+      return 3;
+    }
 
    operations[roi[0]](roi, rod, rwd, 0, 0);
 
@@ -70,6 +70,8 @@ SUCH DAMAGE.
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "GORBIT-IO.h"
+#include "GORBIT-TAIL.h"
 
 /*
 G     ACC = MEM[IMM]
@@ -98,139 +100,151 @@ Translation:
 
 #define MEM 256
 
+#include "GORBIT-PROFILE.h"
+#include "GORBIT-IMAGE.h"
+
 #define DISPATCH \
    ++pc; \
-   if (pc == (MEM - 1)) return; \
-   operations[roi[pc]](roi, rod, rwd, pc, acc);
+   PROFILE_COUNT(pc); \
+   TAIL_CALL operations[roi[pc]](roi, rod, rwd, pc, acc);
 
-extern void (*operations[])(unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc);
+extern void (TAIL_CC * operations[])(unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc);
 
-void G (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void G (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc = rwd[rod[pc]];
 
    DISPATCH
  }
 
-void O (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void O (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    rwd[rod[pc]] = acc;
 
    DISPATCH
  }
 
-void R (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void R (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
-   acc = getchar();
+   acc = ioGet();
 
    DISPATCH
  }
 
-void B (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void B (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
-   if (0 == acc) pc = rod[pc] - 1;
+   if (0 == acc)
+    {
+      PROFILE_TAKEN(pc);
+      pc = rod[pc] - 1;
+    }
 
    DISPATCH
  }
 
-void I (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void I (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc += rod[pc];
 
    DISPATCH
  }
 
-void T (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void T (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
-   putchar(acc);
+   ioPut(acc);
 
    DISPATCH
  }
 
-void S (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void S (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc = rod[pc];
 
    DISPATCH
  }
 
-void A (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void A (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc += rwd[rod[pc]];
 
    DISPATCH
  }
 
-void g (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void g (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc = rwd[rwd[rod[pc]]];
 
    DISPATCH
  }
 
-void o (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void o (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    rwd[rwd[rod[pc]]] = acc;
 
    DISPATCH
  }
 
-void r (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void r (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
-   rwd[rod[pc]] = getchar();
+   rwd[rod[pc]] = ioGet();
 
    DISPATCH
  }
 
-void b (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void b (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
-   if (0 == acc) pc = rwd[rod[pc]] - 1;
+   if (0 == acc)
+    {
+      PROFILE_TAKEN(pc);
+      pc = rwd[rod[pc]] - 1;
+    }
 
    DISPATCH
  }
 
-void i (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void i (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    rwd[rod[pc]] += acc;
 
    DISPATCH
  }
 
-void t (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void t (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
-   putchar(rwd[rod[pc]]);
+   ioPut(rwd[rod[pc]]);
 
    DISPATCH
  }
 
-void s (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void s (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc ^= rwd[rod[pc]];
 
    DISPATCH
  }
 
-void a (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void a (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    acc += rwd[rwd[rod[pc]]];
 
    DISPATCH
  }
 
-void E (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void E (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    (void) rwd;
+   ioFlush();
    printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, roi[pc], rod[pc]);
    exit(1);
  }
 
-void D(unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
+TAIL_HANDLER void D(unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc)
  {
    (void) roi; (void) rod; (void) rwd; (void) pc; (void) acc;
    return;
  }
 
-void (*operations[])(unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc) =
+void (TAIL_CC * operations[])(unsigned char * roi, unsigned char * rod, unsigned char * rwd, int pc, unsigned char acc) =
  {
    E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
    E, E, E, E, E, E, E, E, E, E, E, E, E, E, E, E,
@@ -252,7 +266,7 @@ void (*operations[])(unsigned char * roi, unsigned char * rod, unsigned char * r
 
 void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
  {
-   int input, cur;
+   int input, cur, pc;
 
    input = fgetc(source);
    cur = 0;
@@ -284,9 +298,12 @@ void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
        }
     }
 
-   if (MEM != cur)
+      // Everything after the program, including instruction 255, is the pseudo-instruction "done", so
+      // DISPATCH doesn't have to check for the end of memory.
+   for (pc = cur; pc < MEM; ++pc)
     {
-      roi[cur] = 'D'; // Pseudo-instruction "done"
+      roi[pc] = 'D';
+      rod[pc] = 0;
     }
  }
 
@@ -306,15 +323,22 @@ int main (int argc, char ** argv)
       printf("usage: GORBIT-ROM source_file\n");
       return 2;
     }
-   infile = fopen(argv[1], "r");
-   if (NULL == infile)
+   if (!imageLoad(argv[1], "ROM", roi, rod, NULL, NULL))
     {
-      printf("cannot open input file\n");
-      return 3;
+      infile = fopen(argv[1], "r");
+      if (NULL == infile)
+       {
+         printf("cannot open input file\n");
+         return 3;
+       }
+      loadToMem(roi, rod, infile);
+      fclose(infile);
+      imageSave(roi, rod, NULL, 0);
     }
-   loadToMem(roi, rod, infile);
-   fclose(infile);
+   ioInit();
+   profileInit(argv[1], roi, rod);
 
+   PROFILE_COUNT(0);
    operations[roi[0]](roi, rod, rwd, 0, 0);
 
    return 0;
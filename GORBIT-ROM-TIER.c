@@ -0,0 +1,368 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   Tiered: GORBIT-ROM-CG until a block gets hot, then GORBIT-ROM-BB for it.
+
+   GORBIT-ROM-BB compiles every block the first time it's reached, which is wasted on a program that
+   runs for a millisecond. This engine starts interpreting right away, with computed goto, and counts
+   how many times each block (wherever a B or b goes, and 0) is entered. When one has been entered HOT
+   times, its pc goes to a compiler thread, which compiles it (see GORBIT-BB.h) and publishes it in
+   entry[]. The thread is only started when there's something to compile, so a short run never has one.
+
+   At the start of every block, the interpreter looks in entry[]. If the block is compiled, it calls
+   it, and the compiled blocks run from one to the next until they get to one that isn't, whose stub
+   returns the pc and acc to go on interpreting from.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "GORBIT-IO.h"
+#include "GORBIT-TAIL.h"
+
+/*
+G     ACC = MEM[IMM]
+O     MEM[IMM] = ACC
+R     ACC = INPUT
+B     BRZ IMM
+I     ACC += IMM
+T     PRINT ACC
+S     ACC = IMM
+A     ACC += MEM[IMM]
+
+g     ACC = MEM[MEM[IMM]]
+o     MEM[MEM[IMM]] = ACC
+r     MEM[IMM] = INPUT
+b     BRZ MEM[IMM]
+i     MEM[IMM] += ACC
+t     PRINT MEM[IMM]
+s     ACC ^= MEM[IMM]
+a     ACC += MEM[MEM[IMM]]
+
+Translation, interpreting:
+   ACC      acc
+   IMM      rod[pc]
+   MEM      rwd
+
+Translation, compiled: as in GORBIT-ROM-BB
+*/
+
+#define MEM 256
+#define HOT 1000
+
+#include "GORBIT-IMAGE.h"
+#include "GORBIT-BB.h"
+
+#define DISPATCH \
+   ++pc; \
+   goto *operations[roi[pc]];
+
+   // Blocks waiting for the compiler thread, in the order they got hot. Each is asked for once, so
+   // there are never more than MEM.
+static unsigned char queue [MEM];
+static int queued, taken;
+static unsigned char requested [MEM];
+static pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queueReady = PTHREAD_COND_INITIALIZER;
+static pthread_t compiler;
+static int compilerStarted;
+
+   // The stub of a block that isn't compiled: back to the interpreter.
+TAIL_HANDLER void Interpret (const struct op * ip, unsigned char * rwd, unsigned char acc)
+ {
+   (void) rwd;
+   blockPc = ip->k;
+   blockAcc = acc;
+   return;
+ }
+
+void * compileHot (void * unused)
+ {
+   int pc;
+
+   (void) unused;
+   for (;;)
+    {
+      pthread_mutex_lock(&queueLock);
+      while (taken == queued)
+       {
+         pthread_cond_wait(&queueReady, &queueLock);
+       }
+      pc = queue[taken];
+      ++taken;
+      pthread_mutex_unlock(&queueLock);
+
+      atomic_store_explicit(&entry[pc], compile(pc), memory_order_release);
+    }
+   return NULL;
+ }
+
+   // Ask for the block at pc to be compiled. If the thread can't be started, it never is, and the
+   // block is interpreted, as it has been.
+void request (int pc)
+ {
+   if (requested[pc])
+    {
+      return;
+    }
+   requested[pc] = 1;
+
+   if (!compilerStarted)
+    {
+      if (0 != pthread_create(&compiler, NULL, compileHot, NULL))
+       {
+         return;
+       }
+      pthread_detach(compiler);
+      compilerStarted = 1;
+    }
+
+   pthread_mutex_lock(&queueLock);
+   queue[queued] = pc;
+   ++queued;
+   pthread_cond_signal(&queueReady);
+   pthread_mutex_unlock(&queueLock);
+ }
+
+void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
+ {
+   int input, cur, pc;
+
+   input = fgetc(source);
+   cur = 0;
+
+   while (EOF != input)
+    {
+      roi[cur] = input;
+      rod[cur] = 0;
+
+      input = fgetc(source);
+
+      while ((input >= '0') && (input <= '9'))
+       {
+         rod[cur] = rod[cur] * 10 + (input - '0');
+         input = fgetc(source);
+       }
+
+      while ((' ' == input) || ('\t' == input) || ('\n' == input) || ('\r' == input))
+       {
+         input = fgetc(source);
+       }
+
+//printf("loaded instruction %c%d\n", roi[cur], rod[cur]);
+      ++cur;
+      if (MEM == cur)
+       {
+         printf("error, program too big\n");
+         exit(4);
+       }
+    }
+
+      // Everything after the program, including instruction 255, is the pseudo-instruction "done", so
+      // neither the interpreter nor compile() has to check for the end of memory.
+   for (pc = cur; pc < MEM; ++pc)
+    {
+      roi[pc] = 'D';
+      rod[pc] = 0;
+    }
+ }
+
+int main (int argc, char ** argv)
+ {
+   static unsigned int heat [MEM];
+   const struct op * block;
+   unsigned char rwd [MEM], acc;
+   int pc;
+   FILE * infile;
+
+   void * operations [] =
+    {
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&A, &&B, &&E, &&D, &&E, &&E, &&G, &&E, &&I, &&E, &&E, &&E, &&E, &&E, &&O,
+         &&E, &&E, &&R, &&S, &&T, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&a, &&b, &&E, &&E, &&E, &&E, &&g, &&E, &&i, &&E, &&E, &&E, &&E, &&E, &&o,
+         &&E, &&E, &&r, &&s, &&t, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E
+    };
+
+   for (pc = 0; pc < MEM; ++pc)
+    {
+      rwd[pc] = 0;
+    }
+
+   if (2 != argc)
+    {
+      printf("usage: GORBIT-ROM source_file\n");
+      return 2;
+    }
+   if (!imageLoad(argv[1], "ROM", roi, rod, NULL, NULL))
+    {
+      infile = fopen(argv[1], "r");
+      if (NULL == infile)
+       {
+         printf("cannot open input file\n");
+         return 3;
+       }
+      loadToMem(roi, rod, infile);
+      fclose(infile);
+      imageSave(roi, rod, NULL, 0);
+    }
+   ioInit();
+   blockInit(Interpret);
+
+   pc = 0;
+   acc = 0;
+
+   goto start;
+
+
+   // The start of a block: run it compiled, if it is, and otherwise count it.
+start:
+   block = atomic_load_explicit(&entry[pc], memory_order_acquire);
+   if (stubs + pc != block)
+    {
+      block->handler(block, rwd, acc);
+      if (blockPc < 0)
+       {
+         return 0;
+       }
+      pc = blockPc;
+      acc = blockAcc;
+      goto start;
+    }
+   if (HOT == ++heat[pc])
+    {
+      request(pc);
+    }
+
+   goto *operations[roi[pc]];
+
+
+G:
+   acc = rwd[rod[pc]];
+
+   DISPATCH
+
+O:
+   rwd[rod[pc]] = acc;
+
+   DISPATCH
+
+R:
+   acc = ioGet();
+
+   DISPATCH
+
+B:
+   if (0 == acc) pc = rod[pc];
+   else ++pc;
+
+   goto start;
+
+I:
+   acc += rod[pc];
+
+   DISPATCH
+
+T:
+   ioPut(acc);
+
+   DISPATCH
+
+S:
+   acc = rod[pc];
+
+   DISPATCH
+
+A:
+   acc += rwd[rod[pc]];
+
+   DISPATCH
+
+g:
+   acc = rwd[rwd[rod[pc]]];
+
+   DISPATCH
+
+o:
+   rwd[rwd[rod[pc]]] = acc;
+
+   DISPATCH
+
+r:
+   rwd[rod[pc]] = ioGet();
+
+   DISPATCH
+
+b:
+   if (0 == acc) pc = rwd[rod[pc]];
+   else ++pc;
+
+   goto start;
+
+i:
+   rwd[rod[pc]] += acc;
+
+   DISPATCH
+
+t:
+   ioPut(rwd[rod[pc]]);
+
+   DISPATCH
+
+s:
+   acc ^= rwd[rod[pc]];
+
+   DISPATCH
+
+a:
+   acc += rwd[rwd[rod[pc]]];
+
+   DISPATCH
+
+
+E:
+   ioFlush();
+   printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, roi[pc], rod[pc]);
+   return 1;
+
+D:
+   return 0;
+ }
@@ -71,6 +71,7 @@ SUCH DAMAGE.
 #include <stdio.h>
 #include <stdlib.h>
 #include <setjmp.h>
+#include "GORBIT-IO.h"
 
 /*
 G     ACC = MEM[IMM]
@@ -101,7 +102,6 @@ Translation:
 
 #define DISPATCH \
    ++*pc; \
-   if (*pc == (MEM - 1)) return; \
    if (1024 == gen) longjmp(cont, 1); \
    operations[roi[*pc]](roi, rod, rwd, pc, acc, cont, gen + 1);
 
@@ -123,7 +123,7 @@ void O (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc,
 
 void R (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int gen)
  {
-   *acc = getchar();
+   *acc = ioGet();
 
    DISPATCH
  }
@@ -144,7 +144,7 @@ void I (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc,
 
 void T (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int gen)
  {
-   putchar(*acc);
+   ioPut(*acc);
 
    DISPATCH
  }
@@ -179,7 +179,7 @@ void o (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc,
 
 void r (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int gen)
  {
-   rwd[rod[*pc]] = getchar();
+   rwd[rod[*pc]] = ioGet();
 
    DISPATCH
  }
@@ -200,7 +200,7 @@ void i (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc,
 
 void t (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int gen)
  {
-   putchar(rwd[rod[*pc]]);
+   ioPut(rwd[rod[*pc]]);
 
    DISPATCH
  }
@@ -222,6 +222,7 @@ void a (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc,
 void E (unsigned char * roi, unsigned char * rod, unsigned char * rwd, int * pc, unsigned char * acc, jmp_buf cont, int gen)
  {
    (void) rwd; (void) cont; (void) gen;
+   ioFlush();
    printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", *pc, *acc, roi[*pc], rod[*pc]);
    exit(1);
  }
@@ -254,7 +255,7 @@ void (*operations[])(unsigned char * roi, unsigned char * rod, unsigned char * r
 
 void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
  {
-   int input, cur;
+   int input, cur, pc;
 
    input = fgetc(source);
    cur = 0;
@@ -286,9 +287,12 @@ void loadToMem(unsigned char * roi, unsigned char * rod, FILE* source)
        }
     }
 
-   if (MEM != cur)
+      // Everything after the program, including instruction 255, is the pseudo-instruction "done", so
+      // DISPATCH doesn't have to check for the end of memory.
+   for (pc = cur; pc < MEM; ++pc)
     {
-      roi[cur] = 'D'; // Pseudo-instruction "done"
+      roi[pc] = 'D';
+      rod[pc] = 0;
     }
  }
 
@@ -317,6 +321,7 @@ int main (int argc, char ** argv)
     }
    loadToMem(roi, rod, infile);
    fclose(infile);
+   ioInit();
 
    acc = 0;
    pc = 0;
@@ -0,0 +1,256 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   The stencil generator for GORBIT-ROM-CP.
+
+   usage: GORBIT-STENCIL object_file
+
+   It reads the object file that GORBIT-ROM-CP-STENCILS.c compiles to, and writes a header to
+   standard output with a struct stencil (see GORBIT-CP.h) for every global function in it whose
+   name is one character, which is the instruction it is the handler for: the function's machine
+   code, and a struct hole for every relocation in it. Only relocations against IMM, PC, NEXT, and
+   TARGET are holes, and only 32-bit ones: absolute ones (R_X86_64_32 and R_X86_64_32S) are
+   constants, and PC-relative ones (R_X86_64_PC32 and R_X86_64_PLT32) are jumps. Anything else means
+   that the code refers to something GORBIT-ROM-CP can't fill in, and is an error. So is a call to
+   NEXT or TARGET, rather than a jump: every instruction would leave a return address on the stack.
+
+   The object file has to be a relocatable x86-64 ELF file, which it is when the stencils are built
+   on the machine they'll run on. Errors go to standard error, as standard output is the header.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <elf.h>
+
+   // Same as GORBIT-CP.h, which this doesn't include, as it needs MEM and the engine's types.
+#define HOLE_IMM    0
+#define HOLE_PC     1
+#define HOLE_NEXT   2
+#define HOLE_TARGET 3
+
+static const char * holeNames [] = { "IMM", "PC", "NEXT", "TARGET", NULL };
+static const char * holeMacros [] = { "HOLE_IMM", "HOLE_PC", "HOLE_NEXT", "HOLE_TARGET" };
+
+static unsigned char * object;
+static size_t objectSize;
+
+void fail (const char * message, const char * name)
+ {
+   fprintf(stderr, "GORBIT-STENCIL: %s%s%s\n", message, (NULL == name) ? "" : ": ", (NULL == name) ? "" : name);
+   exit(1);
+ }
+
+   // A part of the object file, checked to be in it.
+void * part (unsigned long long offset, unsigned long long size)
+ {
+   if ((offset > objectSize) || (size > objectSize - offset))
+    {
+      fail("truncated object file", NULL);
+    }
+   return object + offset;
+ }
+
+void readObject (const char * name)
+ {
+   FILE * infile;
+   long size;
+
+   infile = fopen(name, "rb");
+   if (NULL == infile)
+    {
+      fail("cannot open object file", name);
+    }
+   fseek(infile, 0, SEEK_END);
+   size = ftell(infile);
+   rewind(infile);
+   object = (size <= 0) ? NULL : malloc(size);
+   if ((NULL == object) || ((size_t) size != fread(object, 1, size, infile)))
+    {
+      fail("cannot read object file", name);
+    }
+   fclose(infile);
+   objectSize = size;
+ }
+
+   // Write one stencil: its code, then its holes, then return how many holes there are.
+int writeStencil (const Elf64_Shdr * sections, int numSections, const Elf64_Sym * symbols, const char * names,
+   const Elf64_Sym * function, const char * name)
+ {
+   const unsigned char * code;
+   const Elf64_Shdr * section;
+   const Elf64_Rela * relas;
+   const char * target;
+   unsigned long long i, j, numRelas, offset;
+   int numHoles, what, type;
+
+   if ((function->st_shndx == SHN_UNDEF) || (function->st_shndx >= numSections) || (function->st_size > 65535))
+    {
+      fail("function is not a stencil", name);
+    }
+   section = sections + function->st_shndx;
+   if ((SHT_PROGBITS != section->sh_type) || (function->st_value + function->st_size > section->sh_size))
+    {
+      fail("function is not a stencil", name);
+    }
+   code = part(section->sh_offset + function->st_value, function->st_size);
+
+   printf("static const unsigned char stencilCode_%s [] =\n {", name);
+   for (i = 0; i < function->st_size; ++i)
+    {
+      printf("%s0x%02x", (0 == i) ? "\n   " : (0 == i % 12) ? ",\n   " : ", ", code[i]);
+    }
+   printf("\n };\n");
+
+   printf("static const struct hole stencilHoles_%s [] =\n {\n", name);
+   numHoles = 0;
+   for (i = 0; i < (unsigned long long) numSections; ++i)
+    {
+      if ((SHT_REL == sections[i].sh_type) && (sections[i].sh_info == function->st_shndx))
+       {
+         fail("unexpected REL relocations", name);
+       }
+      if ((SHT_RELA != sections[i].sh_type) || (sections[i].sh_info != function->st_shndx))
+       {
+         continue;
+       }
+      numRelas = sections[i].sh_size / sizeof(Elf64_Rela);
+      relas = part(sections[i].sh_offset, numRelas * sizeof(Elf64_Rela));
+      for (j = 0; j < numRelas; ++j)
+       {
+         if ((relas[j].r_offset < function->st_value) || (relas[j].r_offset >= function->st_value + function->st_size))
+          {
+            continue;
+          }
+         target = names + symbols[ELF64_R_SYM(relas[j].r_info)].st_name;
+         for (what = 0; (NULL != holeNames[what]) && (0 != strcmp(holeNames[what], target)); ++what) ;
+         if (NULL == holeNames[what])
+          {
+            fprintf(stderr, "GORBIT-STENCIL: %s refers to %s\n", name, ('\0' == *target) ? "a section" : target);
+            exit(1);
+          }
+         type = ELF64_R_TYPE(relas[j].r_info);
+         if ((R_X86_64_32 != type) && (R_X86_64_32S != type) && (R_X86_64_PC32 != type) && (R_X86_64_PLT32 != type))
+          {
+            fprintf(stderr, "GORBIT-STENCIL: %s has a relocation of type %d\n", name, type);
+            exit(1);
+          }
+         offset = relas[j].r_offset - function->st_value;
+         if (((HOLE_NEXT == what) || (HOLE_TARGET == what)) && ((offset < 2) ||
+            !((0xE9 == code[offset - 1]) || ((0x0F == code[offset - 2]) && (0x80 == (code[offset - 1] & 0xF0))))))
+          {
+            fprintf(stderr, "GORBIT-STENCIL: %s calls %s, rather than jumping to it\n", name, target);
+            exit(1);
+          }
+         printf("   { %llu, %s, %d, %lld },\n", offset, holeMacros[what],
+            (R_X86_64_PC32 == type) || (R_X86_64_PLT32 == type), (long long) relas[j].r_addend);
+         ++numHoles;
+       }
+    }
+   if (0 == numHoles)
+    {
+      printf("   { 0, 0, 0, 0 } // none: this is so that the array isn't empty\n");
+    }
+   printf(" };\n\n");
+
+   return numHoles;
+ }
+
+int main (int argc, char ** argv)
+ {
+   const Elf64_Ehdr * header;
+   const Elf64_Shdr * sections, * symtab;
+   const Elf64_Sym * symbols;
+   const char * names, * name;
+   char list [65536];
+   size_t listSize;
+   unsigned long long i, numSymbols;
+   int numHoles, numStencils;
+
+   if (2 != argc)
+    {
+      printf("usage: GORBIT-STENCIL object_file\n");
+      return 2;
+    }
+   readObject(argv[1]);
+
+   header = part(0, sizeof(Elf64_Ehdr));
+   if ((0 != memcmp(header->e_ident, ELFMAG, SELFMAG)) || (ELFCLASS64 != header->e_ident[EI_CLASS]) ||
+      (ELFDATA2LSB != header->e_ident[EI_DATA]) || (ET_REL != header->e_type) || (EM_X86_64 != header->e_machine))
+    {
+      fail("not a relocatable x86-64 ELF file", argv[1]);
+    }
+   sections = part(header->e_shoff, (unsigned long long) header->e_shnum * sizeof(Elf64_Shdr));
+
+   symtab = NULL;
+   for (i = 0; i < header->e_shnum; ++i)
+    {
+      if (SHT_SYMTAB == sections[i].sh_type) symtab = sections + i;
+    }
+   if ((NULL == symtab) || (symtab->sh_link >= header->e_shnum))
+    {
+      fail("no symbol table", argv[1]);
+    }
+   numSymbols = symtab->sh_size / sizeof(Elf64_Sym);
+   symbols = part(symtab->sh_offset, numSymbols * sizeof(Elf64_Sym));
+   names = part(sections[symtab->sh_link].sh_offset, sections[symtab->sh_link].sh_size);
+   if ((0 == sections[symtab->sh_link].sh_size) || ('\0' != names[sections[symtab->sh_link].sh_size - 1]))
+    {
+      fail("bad string table", argv[1]);
+    }
+
+   printf("/* Generated from %s by GORBIT-STENCIL. Don't edit it: edit GORBIT-ROM-CP-STENCILS.c. */\n\n", argv[1]);
+
+   listSize = 0;
+   numStencils = 0;
+   for (i = 0; i < numSymbols; ++i)
+    {
+      if (symbols[i].st_name >= sections[symtab->sh_link].sh_size) fail("bad symbol name", argv[1]);
+      name = names + symbols[i].st_name;
+      if ((STT_FUNC != ELF64_ST_TYPE(symbols[i].st_info)) || (STB_GLOBAL != ELF64_ST_BIND(symbols[i].st_info)) ||
+         (1 != strlen(name)))
+       {
+         continue;
+       }
+      numHoles = writeStencil(sections, header->e_shnum, symbols, names, symbols + i, name);
+      listSize += snprintf(list + listSize, sizeof(list) - listSize,
+         "   { '%s', stencilCode_%s, sizeof(stencilCode_%s), stencilHoles_%s, %d },\n", name, name, name, name, numHoles);
+      ++numStencils;
+    }
+   if (0 == numStencils)
+    {
+      fail("no stencils", argv[1]);
+    }
+
+   printf("static const struct stencil stencilList [] =\n {\n%s };\n\n", list);
+   printf("#define NUM_STENCILS %d\n", numStencils);
+
+   return 0;
+ }
@@ -0,0 +1,77 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   Tail calls for the TCO engines, at any optimization level.
+
+   A TCO engine is a chain of handlers, each calling the next, which only works if every one of those
+   calls is compiled as a jump. GCC does that at -O2. At -O0 and -Og, every instruction is another
+   stack frame, and the engine crashes as soon as the stack runs out.
+
+   TAIL_CALL goes in place of the return of the call to the next handler, TAIL_HANDLER in front of
+   every handler, and TAIL_CC in the type of a pointer to a handler.
+
+   If the compiler has musttail (clang 13, GCC 15), TAIL_CALL uses it, and the call is a jump at every
+   optimization level, or the compile fails. If it also has preserve_none (clang 19), the handlers use
+   that calling convention: nothing is callee saved, so a handler that calls something (ioGet, ioPut)
+   has nothing of its own to save, and the arguments stay where the next handler wants them.
+
+   Without musttail, GCC is told to compile the handlers at -O2, whatever the rest of the file is
+   compiled at, as that is where it makes them jumps. The handlers are then no easier to step through
+   at -O0 than at -O2, but the engine works, at the speed of -O2, and the rest of it is debuggable.
+*/
+
+#ifndef GORBIT_TAIL_H
+#define GORBIT_TAIL_H
+
+#ifdef __has_attribute
+#if __has_attribute(musttail)
+#define TAIL_CALL __attribute__((musttail)) return
+#if __has_attribute(preserve_none)
+#define TAIL_CC __attribute__((preserve_none))
+#endif
+#endif
+#endif
+
+#ifndef TAIL_CC
+#define TAIL_CC
+#endif
+
+#ifdef TAIL_CALL
+#define TAIL_HANDLER TAIL_CC
+#else
+#define TAIL_CALL return
+#if defined(__GNUC__) && !defined(__clang__)
+#define TAIL_HANDLER __attribute__((optimize("O2")))
+#else
+#define TAIL_HANDLER
+#endif
+#endif
+
+#endif /* GORBIT_TAIL_H */
@@ -0,0 +1,133 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   The decoder for GORBIT-ROM-TCO-TR's traces.
+
+   usage: GORBIT-TRACE [trace_file]
+
+   It prints the trace (trace.bin, by default) as text, the way the tracing engine used to print it as
+   it went: a line per instruction, with the program's output where it happened, and the message
+   for an illegal instruction at the end, if there was one.
+
+   The trace starts with "GORBITTR", then the program (256 bytes of instructions and 256 of
+   immediates), and then a five byte record for every instruction executed: PC, instruction, ACC after
+   it, an address, and a value. The comment on struct record in GORBIT-ROM-TCO-TR says what the last
+   two are for each instruction.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MEM 256
+
+#define TRACE_MAGIC "GORBITTR"
+#define RECORD 5
+#define RECORDS 65536  // how many to read at a time
+
+int main (int argc, char ** argv)
+ {
+   unsigned char roi [MEM], rod [MEM], magic [sizeof(TRACE_MAGIC) - 1];
+   unsigned char * records, * record;
+   size_t got, i;
+   FILE * infile;
+   int pc, op, acc, address, value;
+
+   if (argc > 2)
+    {
+      printf("usage: GORBIT-TRACE [trace_file]\n");
+      return 2;
+    }
+   infile = fopen((2 == argc) ? argv[1] : "trace.bin", "rb");
+   if (NULL == infile)
+    {
+      printf("cannot open input file\n");
+      return 3;
+    }
+   if ((sizeof(magic) != fread(magic, 1, sizeof(magic), infile)) || (0 != memcmp(magic, TRACE_MAGIC, sizeof(magic))) ||
+       (MEM != fread(roi, 1, MEM, infile)) || (MEM != fread(rod, 1, MEM, infile)))
+    {
+      printf("not a trace file\n");
+      return 1;
+    }
+
+   records = malloc(RECORDS * RECORD);
+   if (NULL == records)
+    {
+      printf("out of memory\n");
+      return 5;
+    }
+
+   while (0 != (got = fread(records, RECORD, RECORDS, infile)))
+    {
+      for (i = 0; i < got; ++i)
+       {
+         record = records + i * RECORD;
+         pc = record[0];
+         op = record[1];
+         acc = record[2];
+         address = record[3];
+         value = record[4];
+
+         switch (op)
+          {
+         case 'G': printf("%03d Executed G: Acc (%d) Imm (%d)\n", pc, acc, rod[pc]); break;
+         case 'O': printf("%03d Executed O: Acc (%d) Imm (%d)\n", pc, acc, rod[pc]); break;
+         case 'R': printf("%03d Executed R: Acc (%d)\n", pc, acc); break;
+         case 'B': printf("--- Executed B: PC (%d)\n", address); break;
+         case 'I': printf("%03d Executed I: Acc (%d)\n", pc, acc); break;
+         case 'T': printf("%c\n%03d Executed T\n", value, pc); break;
+         case 'S': printf("%03d Executed S: Acc (%d)\n", pc, acc); break;
+         case 'A': printf("%03d Executed A\n", pc); break;
+         case 'g': printf("%03d Executed g: Acc (%d) Imm (%d) [Imm] (%d)\n", pc, acc, rod[pc], address); break;
+         case 'o': printf("%03d Executed o: Acc (%d) Imm (%d) [Imm] (%d)\n", pc, acc, rod[pc], address); break;
+         case 'r': printf("%03d Executed r\n", pc); break;
+         case 'b': printf("--- Executed b: PC (%d)\n", address); break;
+         case 'i': printf("%03d Executed i: Acc (%d) Imm (%d) [Imm] (%d)\n", pc, acc, rod[pc], value); break;
+         case 't': printf("%c%03d Executed t\n", value, pc); break;
+         case 's': printf("%03d Executed s\n", pc); break;
+         case 'a': printf("%03d Executed a\n", pc); break;
+         default:
+            printf("Attempt to execute illegal instruction at program counter %d. Accumulator: %d. Instruction: %c%d", pc, acc, op, address);
+            break;
+          }
+       }
+    }
+
+   if (ferror(infile))
+    {
+      printf("cannot read input file\n");
+      return 3;
+    }
+   fclose(infile);
+   free(records);
+
+   return 0;
+ }
@@ -0,0 +1,104 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   libgorbitsa: a GORBITSA-ROM machine to put in another program.
+
+   The engines are programs: they read the program from a file, talk to stdin and stdout, and exit
+   when it's done (or when it isn't). This is the same machine as a struct. Load a program into one,
+   and gorbitsaRun runs it until it halts, traps on an illegal instruction, has run as many
+   instructions as it was allowed, needs input that hasn't been given to it, or has filled its output
+   buffer. It then returns which, and can be called again to carry on (after giving it input, or
+   emptying the output, if that was why it stopped).
+
+   Nothing is global, so any number of machines can be run, interleaved, on any number of threads,
+   as long as each machine is only run by one thread at a time.
+
+      struct gorbitsa vm;
+
+      if (!gorbitsaLoad(&vm, text, size)) ... the program is too big
+      gorbitsaInput(&vm, input, inputSize);
+      gorbitsaEndInput(&vm);
+      while (GORBITSA_OUTPUT == (status = gorbitsaRun(&vm, budget)))
+       {
+         fwrite(vm.output, 1, vm.outputSize, stdout);
+         vm.outputSize = 0;
+       }
+
+   Inside, it is the computed goto engine with superinstructions (GORBIT-ROM-CG-SI), which is the
+   fastest of the interpreters that doesn't rely on the compiler turning calls into jumps. It
+   counts every instruction, so the budget is exact.
+*/
+
+#ifndef GORBITSA_H
+#define GORBITSA_H
+
+#include <stddef.h>
+
+#define GORBITSA_MEM 256
+#define GORBITSA_OUTPUT_SIZE 256
+
+   // What gorbitsaRun returns.
+#define GORBITSA_HALTED  0  // The program is done. Running it again does nothing.
+#define GORBITSA_TRAP    1  // pc is at an illegal instruction. Running it again traps again.
+#define GORBITSA_BUDGET  2  // It has run as many instructions as it was allowed to.
+#define GORBITSA_INPUT   3  // pc is at an R or r, and there is no input: see gorbitsaInput.
+#define GORBITSA_OUTPUT  4  // pc is at a T or t, and output is full: empty it.
+
+struct gorbitsa
+ {
+   unsigned char roi [GORBITSA_MEM], rod [GORBITSA_MEM], rwd [GORBITSA_MEM];
+   unsigned char op [GORBITSA_MEM];  // roi, with superinstructions: what actually runs
+   unsigned char acc;
+   int pc;
+   unsigned long long executed;      // Instructions run, so far.
+
+   const unsigned char * input;      // What R and r read next, and how much of it there is.
+   size_t inputSize;
+   int endOfInput;                   // Once input runs out, R and r read EOF (255), rather than stop.
+
+   unsigned char output [GORBITSA_OUTPUT_SIZE];
+   size_t outputSize;                // Set it to 0 once you've taken the output.
+ };
+
+   // Load a program from its text, and get the machine ready to run it: MEM, ACC, and PC are 0, and
+   // there is no input or output. Returns 0 if the program is too big.
+int gorbitsaLoad (struct gorbitsa * vm, const char * text, size_t size);
+
+   // Give the machine more input. It isn't copied, so it has to stay put until the machine has read
+   // it all (inputSize is 0).
+void gorbitsaInput (struct gorbitsa * vm, const unsigned char * input, size_t size);
+
+   // There is no more input than what has been given.
+void gorbitsaEndInput (struct gorbitsa * vm);
+
+   // Run at most budget instructions, and say why it stopped.
+int gorbitsaRun (struct gorbitsa * vm, unsigned long long budget);
+
+#endif /* GORBITSA_H */
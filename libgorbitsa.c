@@ -0,0 +1,444 @@
+/*
+Copyright (c) 2020 Thomas DiModica.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. Neither the name of Thomas DiModica nor the names of other contributors
+   may be used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THOMAS DIMODICA AND CONTRIBUTORS ``AS IS'' AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED.  IN NO EVENT SHALL THOMAS DIMODICA OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+SUCH DAMAGE.
+*/
+
+/*
+   libgorbitsa: see gorbitsa.h.
+
+   This is GORBIT-ROM-CG-SI with its state in a struct gorbitsa instead of in main, and every way it
+   can stop going to one place that saves the state and says why. The differences:
+
+   The budget is counted down by every instruction, and a superinstruction counts as the instructions
+   it covers. If there are fewer left than that, the superinstruction goes to the handler of its first
+   instruction instead, so that it stops exactly where it should.
+
+   R and r stop before doing anything when there's no input (and more may come), and T and t when the
+   output buffer is full, so that running again picks up at the same instruction.
+
+   The program's own opcodes stay in roi, for whoever looks at a trap. The superinstructions go in op.
+*/
+
+#include <string.h>
+#include "gorbitsa.h"
+
+#define MEM GORBITSA_MEM
+
+   // ++pc, and count the instruction that just ran.
+#define DISPATCH \
+   ++pc; \
+   --left; \
+   if (0 == left) goto spent; \
+   goto *operations[op[pc]];
+
+   // Superinstructions. Their opcodes can't come from a source file: see fuse().
+#define SB_OP     0x80
+#define Sb_OP     0x81
+#define GIOg_OP   0x82
+#define GIO_OP    0x83
+#define IO_OP     0x84
+#define Io_OP     0x85
+#define So_OP     0x86
+#define Si_OP     0x87
+#define Go_OP     0x88
+#define go_OP     0x89
+
+   // Is the sequence at pc the given opcodes?
+static int matches (const unsigned char * roi, int pc, int length, const char * ops)
+ {
+   while ('\0' != *ops)
+    {
+      if ((pc >= length) || (roi[pc] != (unsigned char) *ops))
+       {
+         return 0;
+       }
+      ++pc;
+      ++ops;
+    }
+   return 1;
+ }
+
+static void fuse (const unsigned char * roi, const unsigned char * rod, unsigned char * op, int length)
+ {
+   int pc;
+
+   for (pc = 0; pc < length; ++pc)
+    {
+      if (matches(roi, pc, length, "GIOg") && (rod[pc + 2] == rod[pc + 3]))
+       {
+         op[pc] = GIOg_OP;
+       }
+      else if (matches(roi, pc, length, "GIO"))
+       {
+         op[pc] = GIO_OP;
+       }
+      else if (matches(roi, pc, length, "SB") && (0 == rod[pc]))
+       {
+         op[pc] = SB_OP;
+       }
+      else if (matches(roi, pc, length, "Sb") && (0 == rod[pc]))
+       {
+         op[pc] = Sb_OP;
+       }
+      else if (matches(roi, pc, length, "IO"))
+       {
+         op[pc] = IO_OP;
+       }
+      else if (matches(roi, pc, length, "Io"))
+       {
+         op[pc] = Io_OP;
+       }
+      else if (matches(roi, pc, length, "So"))
+       {
+         op[pc] = So_OP;
+       }
+      else if (matches(roi, pc, length, "Si"))
+       {
+         op[pc] = Si_OP;
+       }
+      else if (matches(roi, pc, length, "Go"))
+       {
+         op[pc] = Go_OP;
+       }
+      else if (matches(roi, pc, length, "go"))
+       {
+         op[pc] = go_OP;
+       }
+      else if (roi[pc] & 0x80)
+       {
+         op[pc] = '?'; // Still illegal, but no longer a superinstruction.
+       }
+    }
+ }
+
+   // loadToMem, from memory.
+int gorbitsaLoad (struct gorbitsa * vm, const char * text, size_t size)
+ {
+   size_t pos;
+   int cur;
+
+   memset(vm, 0, sizeof(struct gorbitsa));
+
+   pos = 0;
+   cur = 0;
+   while (pos < size)
+    {
+      vm->roi[cur] = text[pos];
+      vm->rod[cur] = 0;
+      ++pos;
+
+      while ((pos < size) && (text[pos] >= '0') && (text[pos] <= '9'))
+       {
+         vm->rod[cur] = vm->rod[cur] * 10 + (text[pos] - '0');
+         ++pos;
+       }
+
+      while ((pos < size) && ((' ' == text[pos]) || ('\t' == text[pos]) || ('\n' == text[pos]) || ('\r' == text[pos])))
+       {
+         ++pos;
+       }
+
+      ++cur;
+      if (MEM == cur)
+       {
+         return 0;
+       }
+    }
+      // Everything after the program, including instruction 255, is the pseudo-instruction "done", so
+      // DISPATCH doesn't have to check for the end of memory.
+   memset(vm->roi + cur, 'D', MEM - cur);
+
+   memcpy(vm->op, vm->roi, MEM);
+   fuse(vm->roi, vm->rod, vm->op, cur);
+   return 1;
+ }
+
+void gorbitsaInput (struct gorbitsa * vm, const unsigned char * input, size_t size)
+ {
+   vm->input = input;
+   vm->inputSize = size;
+ }
+
+void gorbitsaEndInput (struct gorbitsa * vm)
+ {
+   vm->endOfInput = 1;
+ }
+
+   // The next character of input, once we know that there is one or that there won't be.
+static inline unsigned char next (struct gorbitsa * vm)
+ {
+   if (0 == vm->inputSize)
+    {
+      return 255; // EOF
+    }
+   --vm->inputSize;
+   return *vm->input++;
+ }
+
+int gorbitsaRun (struct gorbitsa * vm, unsigned long long budget)
+ {
+   static const void * const operations [] =
+    {
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&A, &&B, &&E, &&D, &&E, &&E, &&G, &&E, &&I, &&E, &&E, &&E, &&E, &&E, &&O,
+         &&E, &&E, &&R, &&S, &&T, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&a, &&b, &&E, &&E, &&E, &&E, &&g, &&E, &&i, &&E, &&E, &&E, &&E, &&E, &&o,
+         &&E, &&E, &&r, &&s, &&t, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&SB, &&Sb, &&GIOg, &&GIO, &&IO, &&Io, &&So, &&Si, &&Go, &&go, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E,
+         &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E, &&E
+    };
+   const unsigned char * op = vm->op, * rod = vm->rod;
+   unsigned char * rwd = vm->rwd, acc;
+   unsigned long long left;
+   int pc, status;
+
+   pc = vm->pc;
+   if (pc == (MEM - 1))
+    {
+      return GORBITSA_HALTED;
+    }
+   if (0 == budget)
+    {
+      return GORBITSA_BUDGET;
+    }
+   acc = vm->acc;
+   left = budget;
+
+   goto *operations[op[pc]];
+
+
+G:
+   acc = rwd[rod[pc]];
+
+   DISPATCH
+
+O:
+   rwd[rod[pc]] = acc;
+
+   DISPATCH
+
+R:
+   if ((0 == vm->inputSize) && !vm->endOfInput) goto input;
+   acc = next(vm);
+
+   DISPATCH
+
+B:
+   if (0 == acc) pc = rod[pc] - 1;
+
+   DISPATCH
+
+I:
+   acc += rod[pc];
+
+   DISPATCH
+
+T:
+   if (GORBITSA_OUTPUT_SIZE == vm->outputSize) goto output;
+   vm->output[vm->outputSize++] = acc;
+
+   DISPATCH
+
+S:
+   acc = rod[pc];
+
+   DISPATCH
+
+A:
+   acc += rwd[rod[pc]];
+
+   DISPATCH
+
+g:
+   acc = rwd[rwd[rod[pc]]];
+
+   DISPATCH
+
+o:
+   rwd[rwd[rod[pc]]] = acc;
+
+   DISPATCH
+
+r:
+   if ((0 == vm->inputSize) && !vm->endOfInput) goto input;
+   rwd[rod[pc]] = next(vm);
+
+   DISPATCH
+
+b:
+   if (0 == acc) pc = rwd[rod[pc]] - 1;
+
+   DISPATCH
+
+i:
+   rwd[rod[pc]] += acc;
+
+   DISPATCH
+
+t:
+   if (GORBITSA_OUTPUT_SIZE == vm->outputSize) goto output;
+   vm->output[vm->outputSize++] = rwd[rod[pc]];
+
+   DISPATCH
+
+s:
+   acc ^= rwd[rod[pc]];
+
+   DISPATCH
+
+a:
+   acc += rwd[rwd[rod[pc]]];
+
+   DISPATCH
+
+
+SB:
+   if (left < 2) goto S;
+   --left;
+   acc = 0;
+   pc = rod[pc + 1] - 1;
+
+   DISPATCH
+
+Sb:
+   if (left < 2) goto S;
+   --left;
+   acc = 0;
+   pc = rwd[rod[pc + 1]] - 1;
+
+   DISPATCH
+
+GIOg:
+   if (left < 4) goto G;
+   left -= 3;
+   acc = rwd[rod[pc]] + rod[pc + 1];
+   rwd[rod[pc + 2]] = acc;
+   acc = rwd[acc];
+   pc += 3;
+
+   DISPATCH
+
+GIO:
+   if (left < 3) goto G;
+   left -= 2;
+   acc = rwd[rod[pc]] + rod[pc + 1];
+   rwd[rod[pc + 2]] = acc;
+   pc += 2;
+
+   DISPATCH
+
+IO:
+   if (left < 2) goto I;
+   --left;
+   acc += rod[pc];
+   rwd[rod[pc + 1]] = acc;
+   ++pc;
+
+   DISPATCH
+
+Io:
+   if (left < 2) goto I;
+   --left;
+   acc += rod[pc];
+   rwd[rwd[rod[pc + 1]]] = acc;
+   ++pc;
+
+   DISPATCH
+
+So:
+   if (left < 2) goto S;
+   --left;
+   acc = rod[pc];
+   rwd[rwd[rod[pc + 1]]] = acc;
+   ++pc;
+
+   DISPATCH
+
+Si:
+   if (left < 2) goto S;
+   --left;
+   acc = rod[pc];
+   rwd[rod[pc + 1]] += acc;
+   ++pc;
+
+   DISPATCH
+
+Go:
+   if (left < 2) goto G;
+   --left;
+   acc = rwd[rod[pc]];
+   rwd[rwd[rod[pc + 1]]] = acc;
+   ++pc;
+
+   DISPATCH
+
+go:
+   if (left < 2) goto g;
+   --left;
+   acc = rwd[rwd[rod[pc]]];
+   rwd[rwd[rod[pc + 1]]] = acc;
+   ++pc;
+
+   DISPATCH
+
+
+   // Every way out: pc is the instruction to run next time.
+input:
+   status = GORBITSA_INPUT;
+   goto stop;
+
+output:
+   status = GORBITSA_OUTPUT;
+   goto stop;
+
+spent:
+   status = GORBITSA_BUDGET;
+   goto stop;
+
+E:
+   status = GORBITSA_TRAP;
+   goto stop;
+
+D:
+   pc = MEM - 1;
+   status = GORBITSA_HALTED;
+
+stop:
+   vm->pc = pc;
+   vm->acc = acc;
+   vm->executed += budget - left;
+   return status;
+ }